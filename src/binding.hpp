@@ -0,0 +1,364 @@
+/**
+ * DO NOT INCLUDE THIS FILE DIRECTLY!
+ *
+ * Struct bindings, enabled with the CONFY_USE_BINDING macro.
+ *
+ * Declare which keys map to which members of a struct by specializing
+ * confy::Binding, and parse straight into it without building a value tree:
+ *
+ * @code
+ * struct Project {
+ *   std::string name;
+ *   double log_level;
+ *   std::vector<std::string> authors;
+ * };
+ *
+ * template <>
+ * struct confy::Binding<Project> {
+ *   static constexpr auto fields = std::make_tuple(
+ *     confy::field("name", &Project::name),
+ *     confy::field<confy::RangeNumType<0, 3>>("log_level", &Project::log_level),
+ *     confy::field("authors", &Project::authors)
+ *   );
+ * };
+ *
+ * Project project;
+ * auto errors = confy::parse_into(config, project);
+ * @endcode
+ *
+ * confy::interface_of<Project>() builds the equivalent runtime schema, to be
+ * used with confy::parse.
+ */
+
+template <typename T>
+struct Binding;
+
+/**
+ * @brief Binds a key to a member. `Validator` is an optional StringType or
+ * NumType subclass (e.g. RangeNumType) checking the value, or each element
+ * of the value for std::vector members.
+ */
+template <typename Class, typename Member, typename Validator>
+struct Field {
+  std::string_view key;
+  Member Class::* member;
+};
+
+template <typename Validator = void, typename Class, typename Member>
+constexpr Field<Class, Member, Validator> field(std::string_view key, Member Class::* member) {
+  return Field<Class, Member, Validator> {key, member};
+}
+
+namespace binding_internal {
+
+template <typename T, typename = void>
+struct is_bound : std::false_type {};
+
+template <typename T>
+struct is_bound<T, std::void_t<decltype(Binding<T>::fields)>> : std::true_type {};
+
+template <typename T>
+struct is_vector : std::false_type {};
+
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+constexpr size_t field_count() {
+  return std::tuple_size_v<std::remove_const_t<decltype(Binding<T>::fields)>>;
+}
+
+template <typename Validator, typename Base>
+std::shared_ptr<Type> leaf_type(const std::shared_ptr<Type>& fallback) {
+  if constexpr (std::is_void_v<Validator>) {
+    return fallback;
+  } else {
+    static_assert(std::is_base_of_v<Base, Validator>, "The validator does not match the member's type");
+    return std::make_shared<Validator>();
+  }
+}
+
+template <typename T>
+std::shared_ptr<Type> object_type();
+
+template <typename Member, typename Validator>
+std::shared_ptr<Type> type_of() {
+  if constexpr (std::is_same_v<Member, std::string>) {
+    return leaf_type<Validator, StringType>(Type::String);
+  } else if constexpr (std::is_arithmetic_v<Member>) {
+    return leaf_type<Validator, NumType>(Type::Number);
+  } else if constexpr (is_vector<Member>::value) {
+    auto element = type_of<typename Member::value_type, Validator>();
+    return Type::Array(element);
+  } else {
+    static_assert(is_bound<Member>::value, "Members must be strings, numbers, vectors or bound structs");
+    static_assert(std::is_void_v<Validator>, "Bound structs can not have a validator");
+    return object_type<Member>();
+  }
+}
+
+template <typename Class, typename Member, typename Validator>
+std::shared_ptr<Type> type_of_field(const Field<Class, Member, Validator>&) {
+  return type_of<Member, Validator>();
+}
+
+template <typename T>
+std::vector<ObjectType::TypePair> fields_of() {
+  std::vector<ObjectType::TypePair> types;
+  std::apply([&](const auto&... fields) {
+    (types.push_back({std::string(fields.key), type_of_field(fields)}), ...);
+  }, Binding<T>::fields);
+  return types;
+}
+
+template <typename T>
+std::shared_ptr<Type> object_type() {
+  return Type::Object(fields_of<T>());
+}
+
+// Key to field index, computed once per bound struct.
+template <typename T>
+const std::unordered_map<std::string_view, size_t>& field_index() {
+  static const auto index = [] {
+    std::unordered_map<std::string_view, size_t> result;
+    size_t i = 0;
+    std::apply([&](const auto&... fields) {
+      (result.emplace(fields.key, i++), ...);
+    }, Binding<T>::fields);
+    return result;
+  }();
+  return index;
+}
+
+template <typename Validator, typename Base, typename Value>
+bool validate(parser_internal::Lexer& lexer, const Value& value) {
+  if constexpr (!std::is_void_v<Validator>) {
+    static_assert(std::is_base_of_v<Base, Validator>, "The validator does not match the member's type");
+    static const Validator validator {};
+    if (auto err = validator.Validator::validate(value)) {
+      lexer.error(err.value());
+      return false;
+    }
+  }
+  return true;
+}
+
+// The name of a member's type, as Type::name gives it for the equivalent schema.
+template <typename Member>
+std::string type_name() {
+  if constexpr (std::is_same_v<Member, std::string>) {
+    return "string";
+  } else if constexpr (std::is_arithmetic_v<Member>) {
+    return "number";
+  } else if constexpr (is_vector<Member>::value) {
+    return "array";
+  } else {
+    return "object";
+  }
+}
+
+template <typename T>
+bool read_entry(parser_internal::Lexer& lexer, T& out, std::vector<bool>& seen, bool is_global);
+
+/**
+ * Values are read the way the runtime parser reads them (see TreeBuilder):
+ * the kind of value is found from the text first and checked against the
+ * member after, so both report the same errors at the same positions.
+ */
+template <typename Member, typename Validator>
+bool read_value(parser_internal::Lexer& lexer, Member& out, bool as_value) {
+  lexer.skip_whitespace(false);
+  auto mismatch = [&](const std::string& got) {
+    return !lexer.error("Expected '" + type_name<Member>() + "' and got '" + got + "'");
+  };
+  if (lexer.peek() == '"') {
+    auto value = lexer.string();
+    if (!value) {
+      return false;
+    }
+    if constexpr (!std::is_same_v<Member, std::string>) {
+      return mismatch(std::string(*value));
+    } else {
+      if (!as_value && !lexer.expect_end_of_value()) {
+        return false;
+      }
+      out.assign(value->data(), value->size());
+      return validate<Validator, StringType>(lexer, out);
+    }
+  } else if (lexer.is_number()) {
+    auto value = lexer.number();
+    if (!value) {
+      return false;
+    }
+    if constexpr (!std::is_arithmetic_v<Member>) {
+      return mismatch("number");
+    } else {
+      if (!as_value && !lexer.expect_end_of_value()) {
+        return false;
+      }
+      if (!validate<Validator, NumType>(lexer, *value)) {
+        return false;
+      }
+      out = static_cast<Member>(*value);
+      return true;
+    }
+  } else if (lexer.peek() == '{') {
+    lexer.next();
+    if (lexer.peek() != '\n') {
+      return !lexer.error("Expected '<newline>' and got '" + lexer.describe() + "'");
+    }
+    if constexpr (!is_bound<Member>::value) {
+      return mismatch("object");
+    } else {
+      std::vector<bool> seen(field_count<Member>());
+      while (lexer.peek() != '}') {
+        lexer.skip_whitespace(true);
+        if (lexer.peek() == '}') {
+          break;
+        }
+        if (!read_entry(lexer, out, seen, false)) {
+          return false;
+        }
+      }
+      lexer.next();
+      return as_value || lexer.expect_end_of_value();
+    }
+  } else if (lexer.peek() == '[') {
+    lexer.next();
+    if constexpr (!is_vector<Member>::value) {
+      return mismatch("array");
+    } else {
+      using Element = typename Member::value_type;
+      // Like the runtime parser, validate strings and numbers once the whole array is read.
+      constexpr bool deferred = std::is_same_v<Element, std::string> || std::is_arithmetic_v<Element>;
+      using ElementValidator = std::conditional_t<deferred, void, Validator>;
+      std::vector<Error::Position> positions;
+      out.clear();
+      lexer.skip_whitespace(false);
+      while (lexer.peek() != ']') {
+        if (!read_value<Element, ElementValidator>(lexer, out.emplace_back(), true)) {
+          return false;
+        }
+        positions.push_back(lexer.pos);
+        lexer.skip_whitespace(false);
+        if (lexer.peek() == ',') {
+          lexer.next();
+          continue;
+        }
+        if (lexer.peek() != ']') {
+          return !lexer.error("Expected ',' or ']' and got '" + lexer.describe() + "'");
+        }
+      }
+      if constexpr (deferred && !std::is_void_v<Validator>) {
+        using Base = std::conditional_t<std::is_same_v<Element, std::string>, StringType, NumType>;
+        auto end = lexer.pos;
+        for (size_t i = 0; i < out.size(); i++) {
+          lexer.pos = positions[i];
+          if (!validate<Validator, Base>(lexer, out[i])) {
+            return false;
+          }
+        }
+        lexer.pos = end;
+      }
+      lexer.next();
+      return as_value || lexer.expect_end_of_value();
+    }
+  }
+  return !lexer.error("Expected a valid value but found '" + lexer.describe() + "'");
+}
+
+template <typename Member, typename Class, typename Validator>
+bool read_field_value(parser_internal::Lexer& lexer, Member& out, bool use_equals, const Field<Class, Member, Validator>*) {
+  if (use_equals) {
+    if (lexer.peek() != '=') {
+      return !lexer.error("Expected '=' and got '" + lexer.describe() + "'");
+    }
+    lexer.next();
+  }
+  return read_value<Member, Validator>(lexer, out, false);
+}
+
+template <typename T, size_t... I>
+bool read_field(parser_internal::Lexer& lexer, T& out, size_t index, bool use_equals, std::index_sequence<I...>) {
+  bool result = false;
+  // Only the field matching `index` is read.
+  ((I == index ? (result = [&] {
+    const auto& field = std::get<I>(Binding<T>::fields);
+    using F = std::remove_const_t<std::remove_reference_t<decltype(field)>>;
+    return read_field_value(lexer, out.*(field.member), use_equals, static_cast<const F*>(nullptr));
+  }(), true) : false) || ...);
+  return result;
+}
+
+template <typename T>
+bool read_entry(parser_internal::Lexer& lexer, T& out, std::vector<bool>& seen, bool is_global) {
+  Error::Position copy_pos = lexer.pos;
+  auto identifier = lexer.identifier();
+  if (!identifier) {
+    return !lexer.error("Expected identifier and got '" + lexer.describe() + "'");
+  }
+  // Errors about the key are reported where the runtime parser reports them:
+  // at the key for top level values, past the spaces following it otherwise.
+  lexer.skip_whitespace(false);
+  const auto& index = field_index<T>();
+  auto it = index.find(*identifier);
+  if (it == index.end() || seen[it->second]) {
+    if (is_global) {
+      lexer.pos = copy_pos;
+    }
+    auto problem = it == index.end() ? "Unknown identifier '" : "Duplicate identifier '";
+    return !lexer.error(problem + std::string(*identifier) + "'");
+  }
+  seen[it->second] = true;
+  // Top level objects can be declared either as `name = {` or as `name {`.
+  bool use_equals = !is_global || lexer.peek() != '{';
+  return read_field(lexer, out, it->second, use_equals, std::make_index_sequence<field_count<T>()>());
+}
+
+} // namespace binding_internal
+
+/**
+ * @brief The runtime schema equivalent to a bound struct.
+ */
+template <typename T>
+Interface interface_of() {
+  static_assert(binding_internal::is_bound<T>::value, "confy::Binding<T> is not specialized for this type");
+  return Interface::create(binding_internal::fields_of<T>());
+}
+
+/**
+ * @brief Parse a configuration straight into a bound struct.
+ *
+ * Members whose key is missing from the configuration are left untouched,
+ * so they can be given defaults beforehand.
+ *
+ * @return The errors found, parsing stops at the first one.
+ */
+template <typename T>
+std::vector<Error> parse_into(std::string_view config, T& out) {
+  static_assert(binding_internal::is_bound<T>::value, "confy::Binding<T> is not specialized for this type");
+  std::vector<Error> errors;
+  parser_internal::Lexer lexer(config, errors);
+  std::vector<bool> seen(binding_internal::field_count<T>());
+  while (true) {
+    lexer.skip_whitespace(true);
+    if (lexer.at_end() || lexer.peek() == 0) {
+      break;
+    }
+    if (!binding_internal::read_entry(lexer, out, seen, true)) {
+      break;
+    }
+  }
+  return errors;
+}
+
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE
+template <typename T>
+std::vector<Error> parse_file_into(T& out, const std::string& file = CONFY_DEFAULT_FILE) {
+  auto buffer = Buffer::read(file);
+  if (!buffer) {
+    return {Error("Could not open file", Error::Position {1, 1})};
+  }
+  return parse_into(buffer->view(), out);
+}
+#endif
@@ -35,7 +35,12 @@
  *   - CONFY_NO_ASSERT: If you define this macro, we will not use the assert macro.
  *   - CONFY_DEFAULT_FILE: If you define this macro, we will use this as the default file for the parse_file function.
  *   - CONFY_USE_FILE: If you define this macro, we will enable the parse_file function.
+ *   - CONFY_USE_MMAP: If you define this macro to 0, Options::map_file will read the file instead of memory-mapping it.
+ *   - CONFY_NO_SIMD: If you define this macro, the scanner will not use SSE2/AVX2 instructions.
  *   - CONFY_USE_UTILS: If you define this macro, we will include the utils classes.
+ *   - CONFY_USE_BINDING: If you define this macro, we will include the struct bindings (see binding.hpp).
+ *   - CONFY_USE_RELOAD: If you define this macro, we will enable the Reloader class (requires CONFY_USE_FILE).
+ *   - CONFY_USE_STATS: If you define this macro, results will record parse statistics and Options::hooks will be called.
  */
 
 #endif // Finish License Check!
@@ -44,10 +49,31 @@
 #define __CONFY_MAIN_H__
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <deque>
 #include <unordered_map>
 #include <optional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+
+#ifndef CONFY_NO_SIMD
+#if defined(__AVX2__)
+#define CONFY_SIMD_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONFY_SIMD_SSE2 1
+#endif
+#if defined(CONFY_SIMD_SSE2) || defined(CONFY_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+#endif
 
 #ifndef CONFY_NO_ASSERT
 #include <cassert>
@@ -56,16 +82,69 @@
 #define CONFY_ASSERT(x, m)
 #endif
 
+// Instrumentation statements, which compile to nothing without CONFY_USE_STATS.
+#ifdef CONFY_USE_STATS
+#include <chrono>
+#include <algorithm>
+#define CONFY_STATS(...) __VA_ARGS__
+#else
+#define CONFY_STATS(...)
+#endif
+
 #ifndef CONFY_USE_FILE
 #define CONFY_USE_FILE 1
 #endif
 
 #if defined(CONFY_USE_FILE) && CONFY_USE_FILE
 #include <fstream>
+#include <cstdio>
+#include <typeinfo>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#endif
+
+#ifndef CONFY_USE_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define CONFY_USE_MMAP 1
+#else
+#define CONFY_USE_MMAP 0
+#endif
+#endif
+
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE && CONFY_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #ifdef CONFY_USE_UTILS
 #include <regex>
+#include <bitset>
+#include <map>
+#include <algorithm>
+#include <limits>
+#endif
+
+#ifdef CONFY_USE_BINDING
+#include <tuple>
+#include <utility>
+#endif
+
+#if defined(CONFY_USE_RELOAD) && defined(CONFY_USE_FILE) && CONFY_USE_FILE
+#include <functional>
+#include <condition_variable>
+#include <filesystem>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#endif
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
 #endif
 
 #ifndef CONFY_DEFAULT_FILE
@@ -76,6 +155,82 @@ namespace confy {
 
 class Interface;
 class Type;
+class StringType;
+class NumType;
+class ObjectType;
+class ArrayType;
+class Value;
+class String;
+class Number;
+class Object;
+class Array;
+
+/**
+ * @brief A tag shared by types and values, so checks and downcasts are a single compare.
+ *
+ * User types inheriting from StringType or NumType keep their parent's kind.
+ */
+enum class Kind : uint8_t {
+  Other,
+  String,
+  Number,
+  Object,
+  Array,
+};
+
+/**
+ * @brief Maps a class to the kind tagging it and its subclasses.
+ *
+ * Classes without a specialization are checked with dynamic_cast instead.
+ */
+template <typename T>
+struct KindOf {
+  static constexpr bool tagged = false;
+};
+
+#define CONFY_TAG_KIND(T, K) \
+  template <> \
+  struct KindOf<T> { \
+    static constexpr bool tagged = true; \
+    static constexpr Kind value = K; \
+  };
+
+CONFY_TAG_KIND(StringType, Kind::String)
+CONFY_TAG_KIND(NumType, Kind::Number)
+CONFY_TAG_KIND(ObjectType, Kind::Object)
+CONFY_TAG_KIND(ArrayType, Kind::Array)
+CONFY_TAG_KIND(String, Kind::String)
+CONFY_TAG_KIND(Number, Kind::Number)
+CONFY_TAG_KIND(Object, Kind::Object)
+CONFY_TAG_KIND(Array, Kind::Array)
+
+#undef CONFY_TAG_KIND
+
+#if defined(__cpp_lib_span)
+template <typename T>
+using Span = std::span<T>;
+#else
+/**
+ * @brief A non-owning view over contiguous elements (std::span before C++20).
+ */
+template <typename T>
+class Span {
+public:
+  Span() = default;
+  Span(T* data, size_t size) : elements(data), count(size) {}
+
+  T* data() const { return elements; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  T* begin() const { return elements; }
+  T* end() const { return elements + count; }
+  T& operator[](size_t index) const { return elements[index]; }
+private:
+  T* elements = nullptr;
+  size_t count = 0;
+};
+#endif
 
 /**
  * @brief A type class to represent the type of a key in the configuration.
@@ -83,7 +238,7 @@ class Type;
  * This is to make sure that the configuration is correct and that the parser
  * will not throw an exception if the key satisfies the schema.
  */
-class Type {
+class Type : public std::enable_shared_from_this<Type> {
 public:
   Type();
   Type(const Type& other);
@@ -94,35 +249,74 @@ public:
   virtual bool is(const Type* other) const = 0;
   bool is(const std::shared_ptr<Type>& other) const;
 
+  /**
+   * @brief Describes the type and how it validates, used to tell schemas apart
+   * (e.g. to invalidate cached results).
+   *
+   * Defaults to the name of the concrete class. Types whose validation depends
+   * on runtime parameters must add them (see StrRegexType).
+   */
+  virtual std::string fingerprint() const;
+
+  Kind get_kind() const;
+
   template <typename T>
   bool is() const {
-    return dynamic_cast<const T*>(this) != nullptr;
+    if constexpr (KindOf<std::remove_const_t<T>>::tagged) {
+      return kind == KindOf<std::remove_const_t<T>>::value;
+    } else {
+      return dynamic_cast<const T*>(this) != nullptr;
+    }
   }
 
+  /**
+   * @brief Call the visitor with this type downcast to StringType, NumType,
+   * ObjectType or ArrayType (or Type for other kinds), without RTTI.
+   */
+  template <typename F>
+  decltype(auto) visit(F&& visitor) const;
+
   static std::shared_ptr<Type> String;
   static std::shared_ptr<Type> Number;
   static std::shared_ptr<Type> Object(std::vector<std::pair<std::string, std::shared_ptr<Type>>> types);
   static std::shared_ptr<Type> Array(std::shared_ptr<Type>& type);
+protected:
+  Type(Kind kind);
+private:
+  Kind kind = Kind::Other;
 };
 
 class StringType : public Type {
 public:
+  StringType();
   virtual std::string name() const override;
   virtual bool is(const Type* other) const override;
 
   static std::shared_ptr<Type> create();
 
   virtual std::optional<std::string> validate(const std::string& value) const;
+  /**
+   * @brief Validate many values with one call, e.g. the elements of an array.
+   *
+   * Calls validate for each value by default, subclasses can override it to
+   * check them all at once.
+   *
+   * @return The index of the first invalid value and its error.
+   */
+  virtual std::optional<std::pair<size_t, std::string>> validate_each(Span<const std::string_view> values) const;
 };
 
 class NumType : public Type {
 public:
+  NumType();
   virtual std::string name() const override;
   virtual bool is(const Type* other) const override;
 
   static std::shared_ptr<Type> create();
 
   virtual std::optional<std::string> validate(double value) const;
+  // See StringType::validate_each.
+  virtual std::optional<std::pair<size_t, std::string>> validate_each(Span<const double> values) const;
 };
 
 class ObjectType final : public Type {
@@ -130,18 +324,39 @@ public:
   using TypePair = std::pair<std::string, std::shared_ptr<Type>>;
 
   ObjectType(std::vector<TypePair> types);
+  ObjectType(const ObjectType& other);
+  ObjectType& operator=(const ObjectType& other) = delete;
   virtual std::string name() const override;
   virtual bool is(const Type* other) const override;
+  virtual std::string fingerprint() const override;
   
-  std::shared_ptr<Type> get(const std::string& key) const;
+  std::shared_ptr<Type> get(std::string_view key) const;
   std::vector<TypePair> get_types() const;
-  bool has(const std::string& key) const;
+  bool has(std::string_view key) const;
+
+  /**
+   * @brief Look up a key in O(1) without copying the type.
+   * @return The key's entry in the schema, or nullptr if it is unknown.
+   */
+  const TypePair* find(std::string_view key) const;
+
+  /**
+   * @brief The position of a key in the schema (its slot), in O(1).
+   * @return The number of keys (see size()) if the key is unknown.
+   */
+  size_t slot(std::string_view key) const;
+  const TypePair& at(size_t slot) const;
+  size_t size() const;
 
   virtual ~ObjectType() = default;
 
   static std::shared_ptr<Type> create(std::vector<TypePair>& types);
 private:
+  void build_index();
+
   std::vector<TypePair> types;
+  // Compiled once from `types`, the keys point into it.
+  std::unordered_map<std::string_view, size_t> index;
 };
 
 class ArrayType final : public Type {
@@ -149,8 +364,9 @@ public:
   ArrayType(std::shared_ptr<Type> type);
   virtual std::string name() const override;
   virtual bool is(const Type* other) const override;
+  virtual std::string fingerprint() const override;
 
-  std::shared_ptr<Type> get() const;
+  const std::shared_ptr<Type>& get() const;
 
   virtual ~ArrayType() = default;
 
@@ -208,83 +424,357 @@ private:
   Position position;
 };  
 
+/**
+ * @brief A parsed value.
+ *
+ * Values point to their type without owning it, so parsing in parallel does
+ * not contend on the types' reference counts. Results keep the schema their
+ * values were parsed against alive, values created directly need their type
+ * to outlive them (as the built-in types and those of a live Interface do).
+ */
 class Value {
 public:
   Value(std::shared_ptr<Type> type);
   virtual ~Value() = default;
 
   std::shared_ptr<Type> get_type() const;
+  // The type without touching its reference count.
+  const Type* get_type_ref() const;
+  Kind get_kind() const;
   
-  virtual bool is_string() const;
-  virtual bool is_number() const;
-  virtual bool is_object() const;
-  virtual bool is_array() const;
+  bool is_string() const;
+  bool is_number() const;
+  bool is_object() const;
+  bool is_array() const;
+
+  /**
+   * @brief Call the visitor with this value downcast to String, Number, Object
+   * or Array (or Value for other kinds), without RTTI.
+   */
+  template <typename F>
+  decltype(auto) visit(F&& visitor) const;
 
   virtual std::string as_string() const;
+  virtual std::string_view as_string_view() const;
   virtual double as_number() const;
   virtual std::unordered_map<std::string, std::shared_ptr<Value>> as_object() const;
   virtual std::vector<std::shared_ptr<Value>> as_array() const;
 
   static std::shared_ptr<Value> create(std::shared_ptr<Type> type);
+protected:
+  Value(std::shared_ptr<Type> type, Kind kind);
+  // Used by the parser, which only has the schema's types by pointer.
+  Value(const Type* type, Kind kind);
 private:
-  std::shared_ptr<Type> type;
+  const Type* type;
+  Kind kind = Kind::Other;
 };
 
 class Object final : public Value {
 public:
+  /**
+   * Entries by key, to create objects from. Keys are views, kept as given only
+   * for the keys the type does not declare.
+   */
+  using Map = std::pmr::unordered_map<std::string_view, std::shared_ptr<Value>>;
+  /**
+   * The entries of an object by slot of its type (see ObjectType::slot), nullptr
+   * for the keys it does not have. Their keys are the type's own.
+   */
+  using Slots = std::pmr::vector<std::shared_ptr<Value>>;
+
   Object(std::shared_ptr<Type> type, std::unordered_map<std::string, std::shared_ptr<Value>> values);
+  Object(std::shared_ptr<Type> type, Map values);
+  Object(const Type* type, Map values);
+  // `values` must have one slot per key of the type.
+  Object(const Type* type, Slots values);
+  Object(const Object& other);
+  Object& operator=(const Object& other) = delete;
   virtual ~Object() = default;
 
+  /**
+   * @brief Iterates over the entries of an object without copying them, in
+   * the order of its type's keys.
+   *
+   * Example: `for (const auto& [key, value] : *object) { ... }`
+   */
+  class Iterator {
+  public:
+    using value_type = std::pair<std::string_view, const std::shared_ptr<Value>&>;
+
+    Iterator(const Object* object, size_t slot, Map::const_iterator it);
+
+    value_type operator*() const;
+    Iterator& operator++();
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+  private:
+    // Moves past the empty slots.
+    void skip();
+
+    const Object* object;
+    size_t slot;
+    // Through the keys the type does not declare, once past the slots.
+    Map::const_iterator it;
+  };
+
   std::unordered_map<std::string, std::shared_ptr<Value>> get_values() const;
   std::optional<std::shared_ptr<Value>> get(const std::string& key) const;
   bool has(const std::string& key) const;
 
-  virtual bool is_object() const override;
+  // Non-copying accessors.
+  Iterator begin() const;
+  Iterator end() const;
+  size_t size() const;
+  const Value* find(std::string_view key) const;
+  const Slots& get_slots() const;
+
   virtual std::unordered_map<std::string, std::shared_ptr<Value>> as_object() const override;
 
   static std::shared_ptr<Object> create(std::shared_ptr<Type>, std::unordered_map<std::string, std::shared_ptr<Value>>& values);
+  static std::shared_ptr<Object> create(std::shared_ptr<Type>, Map values);
 private:
-  std::unordered_map<std::string, std::shared_ptr<Value>> values;
+  // Moves the entries of `values` into their slots, and the others into `extra`.
+  void insert(Map& values);
+  std::string_view key_of(size_t slot) const;
+
+  const ObjectType* schema;
+  Slots slots;
+  size_t count = 0;
+  // Only objects created by the user can have keys their type does not declare,
+  // so their storage is only allocated for the first of them.
+  std::unique_ptr<std::deque<std::string>> keys;
+  Map extra;
 };
 
 class Array final : public Value {
 public:
+  using Values = std::pmr::vector<std::shared_ptr<Value>>;
+  using Numbers = std::pmr::vector<double>;
+  // A string of an array of strings, as a range of the array's base.
+  struct Slice {
+    uint32_t offset;
+    uint32_t size;
+  };
+  using Strings = std::pmr::vector<Slice>;
+
   Array(std::shared_ptr<Type> type, std::vector<std::shared_ptr<Value>> values);
+  Array(std::shared_ptr<Type> type, Values values);
+  Array(const Type* type, Values values);
+  /**
+   * Arrays of numbers and strings created by the parser store their elements
+   * contiguously rather than as one Value each: numbers as doubles, strings
+   * as slices of `base` (the parsed buffer).
+   */
+  Array(const Type* type, Numbers numbers);
+  Array(const Type* type, const char* base, Strings strings);
+  // Copies of contiguous arrays create their own elements again.
+  Array(const Array& other);
+  Array(Array&& other) noexcept;
+  Array& operator=(const Array& other);
+  Array& operator=(Array&& other) noexcept;
   virtual ~Array() = default;
 
   std::vector<std::shared_ptr<Value>> get_values() const;
 
-  virtual bool is_array() const override;
+  // Non-copying accessors.
+  // The elements of contiguous arrays are created on the first call.
+  Span<const std::shared_ptr<Value>> get_elements() const;
+  size_t size() const;
+  // The elements of a contiguous array of numbers, empty for other arrays.
+  Span<const double> get_numbers() const;
+  // The element at `index` of an array of strings, empty for other arrays.
+  std::string_view get_string_view(size_t index) const;
+
   virtual std::vector<std::shared_ptr<Value>> as_array() const override;
 
   static std::shared_ptr<Array> create(std::shared_ptr<Type>, std::vector<std::shared_ptr<Value>>& values);
+  static std::shared_ptr<Array> create(std::shared_ptr<Type>, Values values);
 private:
-  std::vector<std::shared_ptr<Value>> values;
+  enum class Storage : uint8_t { Values, Numbers, Strings };
+
+  Storage storage = Storage::Values;
+  mutable Values values;
+  // Whether the elements of a contiguous array were created into `values`.
+  mutable std::atomic<bool> materialized {false};
+  Numbers numbers;
+  const char* base = nullptr;
+  Strings strings;
 };
 
 class String final : public Value {
 public:
   String(std::shared_ptr<Type> type, std::string value);
+  String(std::shared_ptr<Type> type, std::string_view value, bool borrowed);
+  String(const Type* type, std::string_view value, bool borrowed);
   virtual ~String() = default;
 
   std::string get_value() const;
+  std::string_view get_view() const;
 
-  virtual bool is_string() const override;
   virtual std::string as_string() const override;
+  virtual std::string_view as_string_view() const override;
 
   static std::shared_ptr<String> create(std::shared_ptr<Type>, std::string value);
+  /**
+   * @brief Create a string that points into a buffer instead of owning its characters.
+   *
+   * The caller must keep the buffer alive for as long as the string is used.
+   * The parser uses this for every string it reads, pointing into the buffer
+   * owned by the Result.
+   */
+  static std::shared_ptr<String> borrow(std::shared_ptr<Type>, std::string_view value);
 private:
   std::string value;
+  std::string_view borrowed;
+  bool is_borrowed = false;
+};
+
+/**
+ * @brief The storage backing a parsed configuration.
+ *
+ * A buffer either owns the configuration text, borrows it from the caller or
+ * maps it straight from a file. A Result keeps its buffer alive and the strings
+ * the parser creates point into it instead of copying it.
+ */
+class Buffer {
+public:
+  Buffer() = default;
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+  ~Buffer();
+
+  std::string_view view() const;
+  bool is_mapped() const;
+
+  static std::shared_ptr<Buffer> own(std::string config);
+  static std::shared_ptr<Buffer> borrow(std::string_view config);
+  // A part of another buffer, keeping it alive.
+  static std::shared_ptr<Buffer> slice(std::shared_ptr<const Buffer> parent, size_t offset, size_t size);
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE
+  /**
+   * @brief Map a file into memory (or read it when mmap is not available).
+   * @return nullptr if the file could not be opened.
+   */
+  static std::shared_ptr<Buffer> map(const std::string& file);
+  // Read a file into an owned buffer, e.g. when it may be rewritten while in use.
+  static std::shared_ptr<Buffer> read(const std::string& file);
+#endif
+private:
+  std::string owned;
+  std::string_view data;
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+  std::shared_ptr<const Buffer> parent;
+};
+
+/**
+ * @brief A monotonic memory region holding a whole value tree.
+ *
+ * When parsing with Options::use_arena, every value, object entry and array
+ * slot is carved out of one arena owned by the Result. Deallocations are no-ops
+ * and the whole region is released at once when the Result goes away, so
+ * values taken from such a Result must not outlive it.
+ */
+class Arena {
+public:
+  Arena(size_t initial_size = 0);
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  std::pmr::memory_resource* resource();
+
+  static std::shared_ptr<Arena> create(size_t initial_size = 0);
+private:
+  std::pmr::monotonic_buffer_resource pool;
+};
+
+#ifdef CONFY_USE_STATS
+/**
+ * @brief What parsing a configuration cost, see Result::stats.
+ */
+struct Stats {
+  using Duration = std::chrono::nanoseconds;
+
+  // Bytes of the configuration scanned by the parser.
+  size_t bytes = 0;
+  // Values built, by kind (elements of arrays included).
+  size_t strings = 0;
+  size_t numbers = 0;
+  size_t objects = 0;
+  size_t arrays = 0;
+  // Deepest value, top level values being at depth 1.
+  size_t max_depth = 0;
+  // Validator calls (a whole array checked by validate_each counts once).
+  size_t validations = 0;
+  // Allocations requested by the value tree (from the arena with Options::use_arena),
+  // including the elements contiguous arrays create when they are first read.
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+
+  // Wall times of opening the file (when parsing one), of parsing excluding
+  // validation, and of validation.
+  Duration read_time {0};
+  Duration parse_time {0};
+  Duration validate_time {0};
+};
+
+/**
+ * @brief Callbacks around each value and validator call of a parse.
+ *
+ * Values read straight into a contiguous array (see Array) do not get value
+ * callbacks, the validation of the whole array still does.
+ */
+class Hooks {
+public:
+  virtual ~Hooks() = default;
+
+  virtual void on_value_begin(const Type& /* type */, const Error::Position& /* pos */) {}
+  virtual void on_value_end(const Type& /* type */, bool /* ok */) {}
+  virtual void on_validate_begin(const Type& /* type */) {}
+  virtual void on_validate_end(const Type& /* type */, bool /* valid */) {}
+};
+#endif
+
+/**
+ * @brief Options to tweak how a configuration is parsed.
+ */
+struct Options {
+  // Allocate the whole value tree from a single arena owned by the Result.
+  bool use_arena = false;
+  // Values nested deeper than this (top level values being at depth 1) are an error.
+  size_t max_depth = 1024;
+  /**
+   * Only check the syntax up front, and build (and validate against the
+   * schema) each top level value the first time a lookup reaches it. Errors
+   * found then are added to the result's errors.
+   *
+   * The syntax check reads every value like a parse does, without building
+   * it, and a lookup builds the whole top level value it starts with.
+   */
+  bool lazy = false;
+  /**
+   * Memory-map the file in parse_file, parse_files and parse_file_cached
+   * instead of reading it. The result then reads its strings from the file
+   * itself, so the file must not change while the result is alive: it would
+   * see the new contents if the file is rewritten in place, and crash (SIGBUS)
+   * if it is truncated. Files replaced by renaming a new one over them are fine.
+   */
+  bool map_file = false;
+#ifdef CONFY_USE_STATS
+  // Called during the parse, it must outlive it.
+  Hooks* hooks = nullptr;
+#endif
 };
 
 class Number final : public Value {
 public:
   Number(std::shared_ptr<Type> type, double value);
+  Number(const Type* type, double value);
   virtual ~Number() = default;
 
   double get_value() const;
 
-  virtual bool is_number() const override;
   virtual double as_number() const override;
 
   static std::shared_ptr<Number> create(std::shared_ptr<Type>, double value);
@@ -292,6 +782,35 @@ private:
   double value;
 };
 
+template <typename F>
+decltype(auto) Type::visit(F&& visitor) const {
+  switch (kind) {
+    case Kind::String: return visitor(static_cast<const StringType&>(*this));
+    case Kind::Number: return visitor(static_cast<const NumType&>(*this));
+    case Kind::Object: return visitor(static_cast<const ObjectType&>(*this));
+    case Kind::Array: return visitor(static_cast<const ArrayType&>(*this));
+    default: return visitor(*this);
+  }
+}
+
+template <typename F>
+decltype(auto) Value::visit(F&& visitor) const {
+  switch (kind) {
+    case Kind::String: return visitor(static_cast<const String&>(*this));
+    case Kind::Number: return visitor(static_cast<const Number&>(*this));
+    case Kind::Object: return visitor(static_cast<const Object&>(*this));
+    case Kind::Array: return visitor(static_cast<const Array&>(*this));
+    default: return visitor(*this);
+  }
+}
+
+namespace parser_internal {
+class LazyTree;
+#ifdef CONFY_USE_STATS
+class Probe;
+#endif
+} // namespace parser_internal
+
 /**
  * @brief The result of the parser.
  * 
@@ -301,17 +820,52 @@ private:
  * It can also contain the error messages if the configuration is incorrect.
  */
 class Result {
-  std::optional<std::shared_ptr<Value>> search(const std::string& key) const;
+  struct PathIndex;
+  const PathIndex& get_index() const;
 public:
   using RootType = std::unordered_map<std::string, std::shared_ptr<Value>>;
 
+  /**
+   * @brief A dotted key resolved once against a result.
+   *
+   * Looking values up through a path does not allocate nor split the key again.
+   * A path is only valid for the result that compiled it, and as long as it is alive.
+   */
+  class Path {
+  public:
+    Path() = default;
+
+    bool is_valid() const;
+    std::string_view get_key() const;
+    const Value* get_value() const;
+  private:
+    friend class Result;
+    Path(std::string_view key, const Value* value);
+
+    std::string_view key;
+    const Value* value = nullptr;
+  };
+
   Result(RootType root, std::string config, std::vector<Error> errors = {});
+  Result(RootType root, std::shared_ptr<const Buffer> buffer, std::vector<Error> errors = {},
+    std::shared_ptr<Arena> arena = nullptr, std::shared_ptr<const Type> schema = nullptr);
+  Result(const Result& other) = default;
+  Result(Result&& other) = default;
+  // The values are released before what they point into (see the members).
+  Result& operator=(const Result& other);
+  Result& operator=(Result&& other);
   virtual ~Result() = default;
 
   RootType get_root() const;
   std::string get_config() const;
+  std::string_view get_config_view() const;
   std::vector<Error> get_errors() const;
 
+  // Non-copying versions of get_root and get_errors. Both build every value
+  // of lazy results, so the references stay valid while lookups go on.
+  const RootType& get_root_ref() const;
+  const std::vector<Error>& get_errors_ref() const;
+
   std::optional<double> get_number(const std::string& key) const;
   std::optional<std::string> get_string(const std::string& key) const;
   std::optional<std::unordered_map<std::string, std::shared_ptr<Value>>> get_object(const std::string& key) const;
@@ -320,13 +874,86 @@ public:
   double get_number_or(const std::string& key, double def = 0.0) const;
   std::string get_string_or(const std::string& key, std::string def = "") const;
 
+  /**
+   * @brief Resolve a dotted key (e.g. "project.name") once, for repeated lookups.
+   *
+   * Keys are resolved through a flattened index of every object entry, and of
+   * every element (by index, e.g. "servers.0.port") of arrays of objects or
+   * arrays, which is built on the first keyed lookup. Elements of arrays of
+   * numbers or strings have no key. The returned path is invalid if the key
+   * does not exist.
+   */
+  Path compile_path(std::string_view key) const;
+
+  /**
+   * @brief Find every value matching a dotted pattern, where '*' matches any key or index.
+   *
+   * Example: `result.query("servers.*.port")`
+   */
+  std::vector<Path> query(std::string_view pattern) const;
+
+  std::optional<double> get_number(const Path& path) const;
+  std::optional<std::string> get_string(const Path& path) const;
+  std::optional<std::unordered_map<std::string, std::shared_ptr<Value>>> get_object(const Path& path) const;
+  std::optional<std::vector<std::shared_ptr<Value>>> get_array(const Path& path) const;
+
+  double get_number_or(const Path& path, double def = 0.0) const;
+  std::string get_string_or(const Path& path, std::string def = "") const;
+
+  /**
+   * Non-copying lookups, the returned views and pointers live as long as the result.
+   * They are empty (or nullptr) if the key does not exist or has another type.
+   */
+  std::optional<std::string_view> get_string_view(const std::string& key) const;
+  std::optional<std::string_view> get_string_view(const Path& path) const;
+  const Object* get_object_ref(const std::string& key) const;
+  const Object* get_object_ref(const Path& path) const;
+  const Array* get_array_ref(const std::string& key) const;
+  const Array* get_array_ref(const Path& path) const;
+
+  /**
+   * @brief The dotted keys whose value differs between two results.
+   *
+   * Keys only present in one of them are included, objects and indexed arrays
+   * present in both are compared through their entries.
+   */
+  std::vector<std::string> diff(const Result& other) const;
+
+#ifdef CONFY_USE_STATS
+  /**
+   * @brief What parsing this result cost.
+   *
+   * Empty for results that were not parsed (e.g. loaded from a cache).
+   */
+  const Stats& stats() const;
+#endif
+
   bool has_errors() const;
 
   static Result create(RootType root, std::string config, std::vector<Error> errors = {});
+  static Result create(RootType root, std::shared_ptr<const Buffer> buffer, std::vector<Error> errors = {},
+    std::shared_ptr<Arena> arena = nullptr, std::shared_ptr<const Type> schema = nullptr);
 private:
+  // The schema, arena and buffer must outlive the values pointing into them.
+  std::shared_ptr<const Type> schema;
+  std::shared_ptr<Arena> arena;
+#ifdef CONFY_USE_STATS
+  // Counts the allocations of the tree, so it must outlive it as well.
+  friend class parser_internal::Probe;
+  std::shared_ptr<parser_internal::Probe> probe;
+#endif
+  std::shared_ptr<const Buffer> buffer;
+  // The schemas, buffers and arenas of the results merged into this one (see merge).
+  friend Result merge(Interface& root, const Result& base, const Result& overlay);
+  std::vector<std::shared_ptr<const void>> layers;
+  // The values not built yet, for results parsed with Options::lazy. It is shared
+  // between copies, and holds their values and errors instead of `root` and `errors`.
+  friend class parser_internal::LazyTree;
+  std::shared_ptr<parser_internal::LazyTree> lazy;
   RootType root;
-  std::string config;
   std::vector<Error> errors;
+  // Shared between copies, as they share the same tree.
+  std::shared_ptr<PathIndex> index;
 };
 
 /**
@@ -338,30 +965,424 @@ private:
  * @param config The configuration string to parse.
  * @return true if the configuration is correct, false otherwise.
  */
-Result parse(Interface& root, const std::string& config);
+Result parse(Interface& root, const std::string& config, const Options& options = {});
+Result parse(Interface& root, std::string&& config, const Options& options = {});
+Result parse(Interface& root, const char* config, const Options& options = {});
+
+/**
+ * @brief Parse a configuration without copying it.
+ *
+ * The result borrows the given characters: the caller must keep them alive
+ * for as long as the result (or any value taken from it) is in use.
+ */
+Result parse(Interface& root, std::string_view config, const Options& options = {});
+
+/**
+ * @brief Overlay a result on top of another one, both parsed with `root`.
+ *
+ * Keys of `overlay` replace those of `base`, except for objects present in
+ * both, whose entries are merged. Values are shared with the inputs rather
+ * than copied: only the objects on the path to a changed key are created, and
+ * the merged result keeps the inputs' buffers alive, so the inputs themselves
+ * can go away. The merged result has no configuration text, and carries the
+ * errors of both inputs.
+ *
+ * Example:
+ * @code
+ * auto base = confy::merge(root, confy::parse_file(root, "base.confy"), confy::parse_file(root, "prod.confy"));
+ * auto host = confy::merge(root, base, confy::parse_file(root, "host.confy"));
+ * @endcode
+ */
+Result merge(Interface& root, const Result& base, const Result& overlay);
 
 #if defined(CONFY_USE_FILE) && CONFY_USE_FILE
 /**
  * @brief Parse a configuration file with the given root interface.
  * 
  * This function will parse the configuration file with the given root interface.
+ * The file is read into a buffer owned by the result, unless Options::map_file
+ * is set (see it for the rules a mapped file must follow).
+ */
+Result parse_file(Interface& root, const std::string& file = CONFY_DEFAULT_FILE, const Options& options = {});
+
+/**
+ * @brief Parse many configuration files against the same interface in parallel.
+ *
+ * Files are spread over a work-stealing pool of `threads` threads (one per
+ * hardware thread by default). The workers share the interface without
+ * touching its reference counts.
+ *
+ * @return One result per file, in the same order as `files`.
+ */
+std::vector<Result> parse_files(Interface& root, const std::vector<std::string>& files,
+  const Options& options = {}, size_t threads = 0);
+
+/**
+ * @brief Parse a configuration file through a binary cache.
+ *
+ * The cache records a hash of the file's contents and a fingerprint of the
+ * interface (see Type::fingerprint). When both match, the result is rebuilt
+ * from the cache (mapped as well with Options::map_file), without parsing the text nor running the
+ * validators again. Otherwise the file is parsed and, if it has no errors,
+ * the cache is written again.
+ *
+ * @param cache The cache file, `file` followed by ".cache" if empty.
+ */
+Result parse_file_cached(Interface& root, const std::string& file = CONFY_DEFAULT_FILE,
+  const std::string& cache = "", const Options& options = {});
+
+/**
+ * @brief Write the binary cache of a result parsed from `config` (see parse_file_cached).
+ * @return false if the cache could not be written.
+ */
+bool write_cache(const Result& result, Interface& root, std::string_view config, const std::string& cache);
+#endif
+
+/**
+ * @brief Receives the events of a StreamParser.
+ *
+ * Views passed to the handler are only valid during the call.
+ */
+class Handler {
+public:
+  virtual ~Handler() = default;
+
+  // Called before each value of an object, return false to skip the events
+  // of that value (it is still checked against the schema).
+  virtual bool on_key(std::string_view /* key */, const Type& /* type */) { return true; }
+  virtual void on_enter_object() {}
+  virtual void on_exit_object() {}
+  virtual void on_begin_array() {}
+  virtual void on_end_array() {}
+  virtual void on_string(std::string_view /* value */) {}
+  virtual void on_number(double /* value */) {}
+  virtual void on_error(const Error& /* error */) {}
+};
+
+/**
+ * @brief An incremental parser, emitting events instead of building a Result.
+ *
+ * The configuration can be fed in chunks cut anywhere, and is checked against
+ * the interface as it goes. Only the unfinished token and the nesting stack
+ * are kept in memory, so memory is bounded by the nesting depth (and the
+ * longest token) instead of the size of the input. Parsing stops at the first
+ * error, which is reported to the handler.
+ *
+ * Example:
+ * @code
+ * confy::StreamParser parser(root, handler);
+ * while (read(chunk)) {
+ *   parser.feed(chunk);
+ * }
+ * parser.finish();
+ * @endcode
+ */
+class StreamParser {
+public:
+  StreamParser(Interface& root, Handler& handler);
+
+  // Returns false once an error has been found.
+  bool feed(std::string_view chunk);
+  // Signals the end of the input.
+  bool finish();
+
+  bool has_errors() const;
+  const std::vector<Error>& get_errors() const;
+private:
+  struct Token {
+    enum class Kind { Identifier, String, Number, Symbol, Newline, End };
+
+    Kind kind;
+    std::string_view text;
+    Error::Position pos;
+    // The character right after an opening brace, which must be a newline.
+    char next = '\0';
+  };
+
+  struct Frame {
+    // The object being parsed (nullptr for arrays).
+    const ObjectType* object;
+    // The element type, for arrays.
+    const Type* element;
+    // The keys already seen, by schema slot.
+    std::vector<bool> seen;
+    bool emit;
+    // The first element rejected by its validator, reported once the array
+    // is read, as elements are validated together (see StringType::validate_each).
+    std::optional<Error> invalid;
+  };
+
+  enum class State { Entry, Assign, Value, ObjectNewline, ArrayFirst, ArrayNext, EndOfValue, Done };
+
+  bool process(std::string_view input, bool final);
+  std::optional<Token> next_token(std::string_view input, size_t& index, bool final);
+  bool step(const Token& token);
+  bool begin_value(const Token& token);
+  bool end_value(std::optional<std::string> err);
+  bool fail(const std::string& message, const Error::Position& pos);
+  static std::string describe(const Token& token);
+
+  std::shared_ptr<ObjectType> root;
+  Handler& handler;
+  std::vector<Frame> stack;
+  State state = State::Entry;
+  // The type and emission of the value being parsed.
+  const Type* expected = nullptr;
+  bool emit_value = true;
+  bool top_level_object = false;
+  /**
+   * Errors are reported where confy::parse reports them, which can be past
+   * the token they are about: unknown keys of nested objects after the
+   * blanks that follow them, and values rejected by their validator after
+   * the newline that ends them.
+   */
+  std::optional<std::string> key_error;
+  std::optional<std::string> invalid;
+  // Where the last comma of an array ended, as only `,]` is a trailing comma.
+  std::optional<Error::Position> comma_end;
+  // Unconsumed input, when a token is cut between two chunks.
+  std::string pending;
+  Error::Position pos = {1, 1};
+  std::vector<Error> errors;
+};
+
+#if defined(CONFY_USE_RELOAD) && defined(CONFY_USE_FILE) && CONFY_USE_FILE
+/**
+ * @brief Keeps a configuration file parsed while it changes.
+ *
+ * The file is watched from a background thread (with inotify on Linux, by
+ * polling its modification time elsewhere) and parsed again whenever it
+ * changes. Each parse is published as a new immutable snapshot, readers
+ * holding an older snapshot keep using it until they let it go. A reparse
+ * with errors does not replace a snapshot without errors.
+ *
+ * Example:
+ * @code
+ * confy::Reloader config(root, "./project.confy");
+ * config.subscribe([](const confy::Result& snapshot, const std::vector<std::string>& changed) { ... });
+ *
+ * // On any thread.
+ * auto snapshot = config.get();
+ * snapshot->get_number_or("project.log_level");
+ * @endcode
+ */
+class Reloader {
+public:
+  using Snapshot = std::shared_ptr<const Result>;
+  using Callback = std::function<void(const Result& snapshot, const std::vector<std::string>& changed)>;
+
+  /**
+   * @brief A per-thread handle to the current snapshot.
+   *
+   * Checking for a new snapshot is a single atomic load, so reading through
+   * a reader is wait-free until the configuration changes.
+   */
+  class Reader {
+  public:
+    Reader(const Reloader& reloader);
+
+    const Result& get();
+    const Snapshot& snapshot();
+  private:
+    const Reloader& reloader;
+    Snapshot cached;
+    uint64_t version = 0;
+  };
+
+  Reloader(Interface root, std::string file = CONFY_DEFAULT_FILE, Options options = {});
+  Reloader(const Reloader&) = delete;
+  Reloader& operator=(const Reloader&) = delete;
+  ~Reloader();
+
+  Snapshot get() const;
+  uint64_t get_version() const;
+  // The errors of the last reparse, empty if it succeeded.
+  std::vector<Error> get_errors() const;
+
+  /**
+   * @brief Call `callback` from the watching thread after each reload
+   * changing at least one key.
+   * @return An id to unsubscribe with.
+   */
+  size_t subscribe(Callback callback);
+  void unsubscribe(size_t id);
+
+  // Parse the file again now, returns true if a new snapshot was published.
+  bool reload();
+  void stop();
+private:
+  void publish(Snapshot snapshot);
+  void watch();
+
+  Interface root;
+  std::string file;
+  Options options;
+
+#if defined(__cpp_lib_atomic_shared_ptr) && __cpp_lib_atomic_shared_ptr >= 201711L
+  std::atomic<Snapshot> current;
+#else
+  // Only accessed through std::atomic_load and std::atomic_store.
+  Snapshot current;
+#endif
+  // Bumped after each publication, so readers know when to load the snapshot again.
+  std::atomic<uint64_t> version {0};
+
+  // Serializes reloads, readers never take it.
+  std::mutex reload_mutex;
+  // Guards the errors and subscribers.
+  mutable std::mutex mutex;
+  std::vector<Error> errors;
+  std::vector<std::pair<size_t, Callback>> subscribers;
+  size_t next_id = 0;
+
+  std::atomic<bool> running {true};
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+#if defined(__linux__)
+  int stop_pipe[2] = {-1, -1};
+  int notify_fd = -1;
+#endif
+  // The modification time last seen, when polling for changes.
+  std::filesystem::file_time_type last_write;
+  std::thread watcher;
+};
+#endif
+
+namespace parser_internal {
+#ifdef CONFY_USE_STATS
+/**
+ * @brief Records the statistics of a parse and calls its hooks.
+ *
+ * It is also the memory resource of the value tree, counting its
+ * allocations, so the result keeps it alive.
+ */
+class Probe final : public std::pmr::memory_resource {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Probe(std::pmr::memory_resource* upstream, Hooks* hooks);
+
+  // Called around each value, `value` is nullptr if it could not be read.
+  void enter(const Type& type, const Error::Position& pos);
+  void exit(const Type& type, const Value* value);
+
+  // Runs and times `validate`, which returns an error if the value is invalid.
+  template <typename F>
+  auto validate(const Type& type, F&& validate) {
+    if (hooks) {
+      hooks->on_validate_begin(type);
+    }
+    auto start = Clock::now();
+    auto err = validate();
+    stats.validate_time += Clock::now() - start;
+    stats.validations++;
+    if (hooks) {
+      hooks->on_validate_end(type, !err);
+    }
+    return err;
+  }
+
+  void count(Kind kind, size_t values);
+
+  static void attach(Result& result, std::shared_ptr<Probe> probe);
+  // Records the time taken to open the file of a parsed result.
+  static void set_read_time(Result& result, Clock::duration time);
+
+  Stats stats;
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  std::pmr::memory_resource* upstream;
+  // Contiguous arrays allocate their elements through the probe when they are
+  // first read, from any thread.
+  std::mutex mutex;
+  Hooks* hooks;
+  size_t depth = 0;
+};
+#endif
+
+/**
+ * @brief The scanner shared by every parser (value trees and struct bindings).
+ *
+ * It keeps track of the current position, and errors are reported at it.
  */
-Result parse_file(Interface& root, const std::string& file = CONFY_DEFAULT_FILE);
+class Lexer {
+public:
+  Lexer(std::string_view config, std::vector<Error>& errors);
+
+  char peek() const;
+  bool at_end() const;
+
+  // Skips spaces, tabs and comments (and newlines if `and_newline` is set).
+  void skip_whitespace(bool and_newline);
+  // Skips whitespace and consumes the current character.
+  void next();
+  // Consumes the newline ending a value (the end of the file also counts).
+  bool expect_end_of_value();
+
+  std::optional<std::string_view> identifier();
+  bool is_number() const;
+  // Reads a quoted string, the current character must be '"'.
+  std::optional<std::string_view> string();
+  std::optional<double> number();
+
+  // Reports an error at the current position, always returns EXIT_FAILURE.
+  bool error(const std::string& message);
+  // The current character, for error messages.
+  std::string describe() const;
+
+  std::string_view config;
+  size_t char_index = 0;
+  Error::Position pos;
+  std::vector<Error>& errors;
+
+  // Scratch space reused by every array of numbers or strings (which can not nest).
+  std::vector<Error::Position> positions;
+  std::vector<std::string_view> views;
+#ifdef CONFY_USE_STATS
+  // Set while building a value tree, not for struct bindings.
+  Probe* probe = nullptr;
 #endif
+};
+} // namespace parser_internal
 
 namespace utils {
+// Downcasts to a tagged class (see KindOf) compare the kind instead of using RTTI.
 template<typename T, typename U>
-[[nodiscard]] std::shared_ptr<T> as(std::shared_ptr<U>& type) {
-  return std::dynamic_pointer_cast<T>(type);
+constexpr bool is_tagged_cast() {
+  using Target = std::remove_const_t<T>;
+  using Source = std::remove_const_t<U>;
+  return KindOf<Target>::tagged && std::is_base_of_v<Source, Target>;
+}
+
+template<typename T, typename U>
+[[nodiscard]] std::shared_ptr<T> as(const std::shared_ptr<U>& type) {
+  if constexpr (is_tagged_cast<T, U>()) {
+    if (type && type->get_kind() == KindOf<std::remove_const_t<T>>::value) {
+      return std::static_pointer_cast<T>(type);
+    }
+    return nullptr;
+  } else {
+    return std::dynamic_pointer_cast<T>(type);
+  }
 }
 
 template<typename T, typename U>
 [[nodiscard]] T* as(U* type) {
-  return dynamic_cast<T*>(type);
+  if constexpr (is_tagged_cast<T, U>()) {
+    if (type && type->get_kind() == KindOf<std::remove_const_t<T>>::value) {
+      return static_cast<T*>(type);
+    }
+    return nullptr;
+  } else {
+    return dynamic_cast<T*>(type);
+  }
 }
 
 template<typename T, typename U>
-[[nodiscard]] bool is(std::shared_ptr<U>& type) {
+[[nodiscard]] bool is(const std::shared_ptr<U>& type) {
   return as<T>(type) != nullptr;
 }
 
@@ -378,6 +1399,10 @@ std::vector<std::string> split(std::string str, const std::string& delim);
 #include "util_classes.hpp"
 #endif
 
+#ifdef CONFY_USE_BINDING
+#include "binding.hpp"
+#endif
+
 } // namespace confy
 
 #ifdef CONFY_NO_NAMESPACE
@@ -10,11 +10,20 @@
 namespace confy {
 
 Type::Type() {}
+Type::Type(Kind kind) : kind(kind) {}
 Type::Type(const Type& other) = default;
 Type::Type(Type&& other) = default;
 
 bool Type::is(const std::shared_ptr<Type>& other) const {
-  return is(reinterpret_cast<const Type*>(other.get()));
+  return is(other.get());
+}
+
+Kind Type::get_kind() const {
+  return kind;
+}
+
+std::string Type::fingerprint() const {
+  return typeid(*this).name();
 }
 
 std::shared_ptr<Type> Type::String = StringType::create();
@@ -28,6 +37,8 @@ std::shared_ptr<Type> Type::Array(std::shared_ptr<Type>& type) {
   return ArrayType::create(type);
 }
 
+StringType::StringType() : Type(Kind::String) {}
+
 std::string StringType::name() const {
   return "string";
 }
@@ -44,6 +55,17 @@ std::optional<std::string> StringType::validate(const std::string& value) const
   return std::nullopt;
 }
 
+std::optional<std::pair<size_t, std::string>> StringType::validate_each(Span<const std::string_view> values) const {
+  for (size_t i = 0; i < values.size(); i++) {
+    if (auto err = validate(std::string(values[i]))) {
+      return std::make_pair(i, std::move(*err));
+    }
+  }
+  return std::nullopt;
+}
+
+NumType::NumType() : Type(Kind::Number) {}
+
 std::string NumType::name() const {
   return "number";
 }
@@ -56,11 +78,35 @@ std::optional<std::string> NumType::validate(double value) const {
   return std::nullopt;
 }
 
+std::optional<std::pair<size_t, std::string>> NumType::validate_each(Span<const double> values) const {
+  for (size_t i = 0; i < values.size(); i++) {
+    if (auto err = validate(values[i])) {
+      return std::make_pair(i, std::move(*err));
+    }
+  }
+  return std::nullopt;
+}
+
 std::shared_ptr<Type> NumType::create() {
   return std::make_shared<NumType>();
 }
 
-ObjectType::ObjectType(std::vector<TypePair> types) : types(types) {}
+ObjectType::ObjectType(std::vector<TypePair> types) : Type(Kind::Object), types(std::move(types)) {
+  build_index();
+}
+
+ObjectType::ObjectType(const ObjectType& other) : Type(other), types(other.types) {
+  build_index();
+}
+
+void ObjectType::build_index() {
+  index.clear();
+  index.reserve(types.size());
+  for (size_t i = 0; i < types.size(); i++) {
+    // The first declaration wins, like the linear lookup used to do.
+    index.emplace(types[i].first, i);
+  }
+}
 
 std::vector<ObjectType::TypePair> ObjectType::get_types() const {
   return types;
@@ -70,24 +116,46 @@ std::string ObjectType::name() const {
   return "object";
 }
 
-bool ObjectType::has(const std::string& key) const {
-  for (const auto& type : types) {
-    if (type.first == key) {
-      return true;
-    }
+std::string ObjectType::fingerprint() const {
+  std::string result = "{";
+  for (const auto& [key, type] : types) {
+    result += key + ":" + type->fingerprint() + ";";
   }
-  return false;
+  return result + "}";
 }
 
-std::shared_ptr<Type> ObjectType::get(const std::string& key) const {
-  for (const auto& type : types) {
-    if (type.first == key) {
-      return type.second;
-    }
+bool ObjectType::has(std::string_view key) const {
+  return find(key) != nullptr;
+}
+
+std::shared_ptr<Type> ObjectType::get(std::string_view key) const {
+  if (auto type = find(key)) {
+    return type->second;
   }
   return nullptr;
 }
 
+const ObjectType::TypePair* ObjectType::find(std::string_view key) const {
+  auto it = index.find(key);
+  if (it == index.end()) {
+    return nullptr;
+  }
+  return &types[it->second];
+}
+
+size_t ObjectType::slot(std::string_view key) const {
+  auto it = index.find(key);
+  return it == index.end() ? types.size() : it->second;
+}
+
+const ObjectType::TypePair& ObjectType::at(size_t slot) const {
+  return types[slot];
+}
+
+size_t ObjectType::size() const {
+  return types.size();
+}
+
 bool ObjectType::is(const Type* other) const {
   if (const auto obj = utils::as<const ObjectType>(other)) {
     if (types.size() != obj->types.size()) {
@@ -109,13 +177,17 @@ std::shared_ptr<Type> ObjectType::create(std::vector<TypePair>& types) {
   return std::make_shared<ObjectType>(types);
 }
 
-ArrayType::ArrayType(std::shared_ptr<Type> type) : type(type) {}
+ArrayType::ArrayType(std::shared_ptr<Type> type) : Type(Kind::Array), type(type) {}
 
 std::string ArrayType::name() const {
   return "array";
 }
 
-std::shared_ptr<Type> ArrayType::get() const {
+std::string ArrayType::fingerprint() const {
+  return "[" + type->fingerprint() + "]";
+}
+
+const std::shared_ptr<Type>& ArrayType::get() const {
   return type;
 }
 
@@ -146,9 +218,15 @@ Interface Interface::create(std::vector<Interface::Global> globals) {
   return Interface(globals);
 }
 
-Value::Value(std::shared_ptr<Type> type) : type(type) {}
+Value::Value(std::shared_ptr<Type> type) : type(type.get()) {}
+Value::Value(std::shared_ptr<Type> type, Kind kind) : type(type.get()), kind(kind) {}
+Value::Value(const Type* type, Kind kind) : type(type), kind(kind) {}
 
 std::shared_ptr<Type> Value::get_type() const {
+  return std::const_pointer_cast<Type>(type->shared_from_this());
+}
+
+const Type* Value::get_type_ref() const {
   return type;
 }
 
@@ -156,16 +234,23 @@ std::shared_ptr<Value> Value::create(std::shared_ptr<Type> type) {
   return std::make_shared<Value>(type);
 }
 
-bool Value::is_array() const { return false; }
-bool Value::is_number() const { return false; }
-bool Value::is_object() const { return false; }
-bool Value::is_string() const { return false; }
+Kind Value::get_kind() const { return kind; }
+
+bool Value::is_array() const { return kind == Kind::Array; }
+bool Value::is_number() const { return kind == Kind::Number; }
+bool Value::is_object() const { return kind == Kind::Object; }
+bool Value::is_string() const { return kind == Kind::String; }
 
 std::string Value::as_string() const {
   CONFY_ASSERT(false, "Value is not a string");
   return "";
 }
 
+std::string_view Value::as_string_view() const {
+  CONFY_ASSERT(false, "Value is not a string");
+  return {};
+}
+
 double Value::as_number() const {
   CONFY_ASSERT(false, "Value is not a number");
   return 0;
@@ -182,68 +267,344 @@ std::vector<std::shared_ptr<Value>> Value::as_array() const {
 }
 
 Object::Object(std::shared_ptr<Type> type, std::unordered_map<std::string, std::shared_ptr<Value>> values)
-  : Value(type), values(values) {
-    CONFY_ASSERT(utils::is<const ObjectType>(type), "Type is not an object");
+  : Value(type, Kind::Object), schema(utils::as<const ObjectType>(get_type_ref())) {
+    CONFY_ASSERT(schema, "Type is not an object");
+    slots.resize(schema->size());
+    for (auto& [key, value] : values) {
+      auto slot = schema->slot(key);
+      if (slot < slots.size()) {
+        count += value && !slots[slot];
+        slots[slot] = std::move(value);
+      } else {
+        if (!keys) {
+          keys = std::make_unique<std::deque<std::string>>();
+        }
+        keys->push_back(key);
+        extra.emplace(keys->back(), std::move(value));
+      }
+    }
   }
 
-bool Object::is_object() const {
-  return true;
+Object::Object(std::shared_ptr<Type> type, Object::Map values)
+  : Value(type, Kind::Object), schema(utils::as<const ObjectType>(get_type_ref())),
+    slots(values.get_allocator()), extra(values.get_allocator()) {
+    CONFY_ASSERT(schema, "Type is not an object");
+    insert(values);
+  }
+
+Object::Object(const Type* type, Object::Map values)
+  : Value(type, Kind::Object), schema(utils::as<const ObjectType>(type)),
+    slots(values.get_allocator()), extra(values.get_allocator()) {
+    CONFY_ASSERT(schema, "Type is not an object");
+    insert(values);
+  }
+
+Object::Object(const Type* type, Object::Slots values)
+  : Value(type, Kind::Object), schema(utils::as<const ObjectType>(type)),
+    slots(std::move(values)), extra(slots.get_allocator()) {
+    CONFY_ASSERT(schema, "Type is not an object");
+    CONFY_ASSERT(slots.size() == schema->size(), "Objects need one slot per key of their type");
+    for (const auto& value : slots) {
+      count += value != nullptr;
+    }
+  }
+
+Object::Object(const Object& other)
+  : Value(other), schema(other.schema), slots(other.slots, other.slots.get_allocator()),
+    count(other.count), extra(other.extra.get_allocator()) {
+  if (!other.keys) {
+    extra = other.extra;
+    return;
+  }
+  // Our keys must point into our own storage, not into the other object's.
+  keys = std::make_unique<std::deque<std::string>>();
+  for (const auto& [key, value] : other.extra) {
+    keys->emplace_back(key);
+    extra.emplace(keys->back(), value);
+  }
+}
+
+void Object::insert(Object::Map& values) {
+  slots.resize(schema->size());
+  for (auto& [key, value] : values) {
+    auto slot = schema->slot(key);
+    if (slot < slots.size()) {
+      count += value && !slots[slot];
+      slots[slot] = std::move(value);
+    } else {
+      extra.emplace(key, std::move(value));
+    }
+  }
+}
+
+std::string_view Object::key_of(size_t slot) const {
+  return schema->at(slot).first;
 }
 
 std::unordered_map<std::string, std::shared_ptr<Value>> Object::as_object() const {
-  return values;
+  return get_values();
 }
 
 std::unordered_map<std::string, std::shared_ptr<Value>> Object::get_values() const {
-  return values;
+  std::unordered_map<std::string, std::shared_ptr<Value>> result;
+  result.reserve(size());
+  for (const auto& [key, value] : *this) {
+    result.emplace(key, value);
+  }
+  return result;
 }
 
 std::optional<std::shared_ptr<Value>> Object::get(const std::string& key) const {
-  if (values.find(key) != values.end()) {
-    return values.at(key);
+  auto slot = schema->slot(key);
+  if (slot < slots.size()) {
+    if (slots[slot]) {
+      return slots[slot];
+    }
+    return std::nullopt;
+  }
+  auto it = extra.find(key);
+  if (it != extra.end()) {
+    return it->second;
   }
   return std::nullopt;
 }
 
 bool Object::has(const std::string& key) const {
-  return values.find(key) != values.end();
+  auto slot = schema->slot(key);
+  if (slot < slots.size()) {
+    return slots[slot] != nullptr;
+  }
+  return extra.find(key) != extra.end();
+}
+
+Object::Iterator::Iterator(const Object* object, size_t slot, Object::Map::const_iterator it)
+  : object(object), slot(slot), it(it) {
+  skip();
+}
+
+void Object::Iterator::skip() {
+  while (slot < object->slots.size() && !object->slots[slot]) {
+    slot++;
+  }
+}
+
+Object::Iterator::value_type Object::Iterator::operator*() const {
+  if (slot < object->slots.size()) {
+    return {object->key_of(slot), object->slots[slot]};
+  }
+  return {it->first, it->second};
+}
+
+Object::Iterator& Object::Iterator::operator++() {
+  if (slot < object->slots.size()) {
+    slot++;
+    skip();
+  } else {
+    ++it;
+  }
+  return *this;
+}
+
+bool Object::Iterator::operator==(const Object::Iterator& other) const {
+  return slot == other.slot && it == other.it;
+}
+
+bool Object::Iterator::operator!=(const Object::Iterator& other) const {
+  return !(*this == other);
+}
+
+Object::Iterator Object::begin() const {
+  return Iterator(this, 0, extra.begin());
+}
+
+Object::Iterator Object::end() const {
+  return Iterator(this, slots.size(), extra.end());
+}
+
+size_t Object::size() const {
+  return count + extra.size();
+}
+
+const Value* Object::find(std::string_view key) const {
+  auto slot = schema->slot(key);
+  if (slot < slots.size()) {
+    return slots[slot].get();
+  }
+  if (extra.empty()) {
+    return nullptr;
+  }
+  auto it = extra.find(key);
+  return it != extra.end() ? it->second.get() : nullptr;
+}
+
+const Object::Slots& Object::get_slots() const {
+  return slots;
 }
 
 Array::Array(std::shared_ptr<Type> type, std::vector<std::shared_ptr<Value>> values)
-  : Value(type), values(values) {
+  : Value(type, Kind::Array), values(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end())) {
     CONFY_ASSERT(utils::is<const ArrayType>(type), "Type is not an array");
   }
 
-bool Array::is_array() const {
-  return true;
-}
+Array::Array(std::shared_ptr<Type> type, Array::Values values)
+  : Value(type, Kind::Array), values(std::move(values)) {
+    CONFY_ASSERT(utils::is<const ArrayType>(type), "Type is not an array");
+  }
+
+Array::Array(const Type* type, Array::Values values)
+  : Value(type, Kind::Array), values(std::move(values)) {
+    CONFY_ASSERT(utils::is<const ArrayType>(type), "Type is not an array");
+  }
 
 std::vector<std::shared_ptr<Value>> Array::as_array() const {
-  return values;
+  return get_values();
+}
+
+// The resource the elements of a contiguous array are created from when first
+// read. Not the array's arena, which may be in use by another thread, but the
+// probe of the parse when there is one, which counts them and serializes its
+// allocations.
+static std::pmr::memory_resource* element_resource(std::pmr::memory_resource* resource) {
+#ifdef CONFY_USE_STATS
+  if (auto probe = dynamic_cast<parser_internal::Probe*>(resource)) {
+    return probe;
+  }
+#endif
+  (void) resource;
+  return std::pmr::get_default_resource();
+}
+
+Array::Array(const Type* type, Array::Numbers numbers)
+  : Value(type, Kind::Array), storage(Storage::Numbers), values(element_resource(numbers.get_allocator().resource())),
+    numbers(std::move(numbers)) {
+    CONFY_ASSERT(utils::is<const ArrayType>(type), "Type is not an array");
+  }
+
+Array::Array(const Type* type, const char* base, Array::Strings strings)
+  : Value(type, Kind::Array), storage(Storage::Strings), values(element_resource(strings.get_allocator().resource())),
+    base(base), strings(std::move(strings)) {
+    CONFY_ASSERT(utils::is<const ArrayType>(type), "Type is not an array");
+  }
+
+Array::Array(const Array& other)
+  : Value(other), storage(other.storage), values(other.storage == Storage::Values ? other.values : Values()),
+    numbers(other.numbers), base(other.base), strings(other.strings) {}
+
+Array::Array(Array&& other) noexcept
+  : Value(other), storage(other.storage),
+    values(other.storage == Storage::Values ? std::move(other.values) : Values(other.values.get_allocator())),
+    numbers(std::move(other.numbers)), base(other.base), strings(std::move(other.strings)) {}
+
+Array& Array::operator=(const Array& other) {
+  if (this != &other) {
+    Value::operator=(other);
+    storage = other.storage;
+    values = other.storage == Storage::Values ? other.values : Values();
+    materialized.store(false, std::memory_order_relaxed);
+    numbers = other.numbers;
+    base = other.base;
+    strings = other.strings;
+  }
+  return *this;
+}
+
+Array& Array::operator=(Array&& other) noexcept {
+  if (this != &other) {
+    Value::operator=(other);
+    storage = other.storage;
+    values = other.storage == Storage::Values ? std::move(other.values) : Values();
+    materialized.store(false, std::memory_order_relaxed);
+    numbers = std::move(other.numbers);
+    base = other.base;
+    strings = std::move(other.strings);
+  }
+  return *this;
 }
 
 std::vector<std::shared_ptr<Value>> Array::get_values() const {
-  return values;
+  auto elements = get_elements();
+  return std::vector<std::shared_ptr<Value>>(elements.begin(), elements.end());
+}
+
+Span<const std::shared_ptr<Value>> Array::get_elements() const {
+  if (storage != Storage::Values && !materialized.load(std::memory_order_acquire)) {
+    // Arrays are only materialized once, so they can share one lock.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!materialized.load(std::memory_order_relaxed)) {
+      // Allocated from the element resource `values` was created with.
+      auto resource = values.get_allocator().resource();
+      auto element = utils::as<const ArrayType>(get_type_ref())->get().get();
+      values.reserve(size());
+      for (size_t i = 0; i < size(); i++) {
+        if (storage == Storage::Numbers) {
+          values.push_back(std::allocate_shared<Number>(std::pmr::polymorphic_allocator<Number>(resource), element, numbers[i]));
+        } else {
+          values.push_back(std::allocate_shared<String>(std::pmr::polymorphic_allocator<String>(resource),
+            element, get_string_view(i), true));
+        }
+      }
+      materialized.store(true, std::memory_order_release);
+    }
+  }
+  return Span<const std::shared_ptr<Value>>(values.data(), values.size());
+}
+
+size_t Array::size() const {
+  switch (storage) {
+    case Storage::Numbers: return numbers.size();
+    case Storage::Strings: return strings.size();
+    default: return values.size();
+  }
+}
+
+Span<const double> Array::get_numbers() const {
+  return Span<const double>(numbers.data(), numbers.size());
+}
+
+std::string_view Array::get_string_view(size_t index) const {
+  switch (storage) {
+    case Storage::Strings: return std::string_view(base + strings[index].offset, strings[index].size);
+    case Storage::Numbers: return {};
+    default: return values[index]->is_string() ? values[index]->as_string_view() : std::string_view();
+  }
+}
+
+String::String(std::shared_ptr<Type> type, std::string value) : Value(type, Kind::String), value(std::move(value)) {
+  CONFY_ASSERT(utils::is<const StringType>(type), "Type is not a string");
 }
 
-String::String(std::shared_ptr<Type> type, std::string value) : Value(type), value(value) {
+String::String(std::shared_ptr<Type> type, std::string_view value, bool borrowed)
+  : Value(type, Kind::String), value(borrowed ? std::string() : std::string(value)), borrowed(value), is_borrowed(borrowed) {
   CONFY_ASSERT(utils::is<const StringType>(type), "Type is not a string");
 }
 
+String::String(const Type* type, std::string_view value, bool borrowed)
+  : Value(type, Kind::String), value(borrowed ? std::string() : std::string(value)), borrowed(value), is_borrowed(borrowed) {
+  CONFY_ASSERT(utils::is<const StringType>(type), "Type is not a string");
+}
+
+std::string_view String::get_view() const {
+  if (is_borrowed) {
+    return borrowed;
+  }
+  return value;
+}
+
 std::string String::as_string() const {
   return get_value();
 }
 
-bool String::is_string() const {
-  return true;
+std::string_view String::as_string_view() const {
+  return get_view();
 }
 
-Number::Number(std::shared_ptr<Type> type, double value) : Value(type), value(value) {
+Number::Number(std::shared_ptr<Type> type, double value) : Value(type, Kind::Number), value(value) {
   CONFY_ASSERT(utils::is<const NumType>(type), "Type is not a number");
 }
 
-bool Number::is_number() const {
-  return true;
+Number::Number(const Type* type, double value) : Value(type, Kind::Number), value(value) {
+  CONFY_ASSERT(utils::is<const NumType>(type), "Type is not a number");
 }
 
 double Number::as_number() const {
@@ -255,442 +616,2625 @@ double Number::get_value() const {
 }
 
 std::string String::get_value() const {
-  return value;
+  return std::string(get_view());
 }
 
 std::shared_ptr<Object> Object::create(std::shared_ptr<Type> type, std::unordered_map<std::string, std::shared_ptr<Value>>& values) {
   return std::make_shared<Object>(type, values);
 }
 
+std::shared_ptr<Object> Object::create(std::shared_ptr<Type> type, Object::Map values) {
+  return std::make_shared<Object>(type, std::move(values));
+}
+
 std::shared_ptr<Array> Array::create(std::shared_ptr<Type> type, std::vector<std::shared_ptr<Value>>& values) {
   return std::make_shared<Array>(type, values);
 }
 
+std::shared_ptr<Array> Array::create(std::shared_ptr<Type> type, Array::Values values) {
+  return std::make_shared<Array>(type, std::move(values));
+}
+
 std::shared_ptr<String> String::create(std::shared_ptr<Type> type, std::string value) {
-  return std::make_shared<String>(type, value);
+  return std::make_shared<String>(type, std::move(value));
 }
 
-std::shared_ptr<Number> Number::create(std::shared_ptr<Type> type, double value) {
-  return std::make_shared<Number>(type, value);
+std::shared_ptr<String> String::borrow(std::shared_ptr<Type> type, std::string_view value) {
+  return std::make_shared<String>(type, value, true);
 }
 
-Result::Result(Result::RootType values, std::string config, std::vector<Error> errors)
-  : root(values), config(config), errors(errors) {}
+Buffer::~Buffer() {
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE && CONFY_USE_MMAP
+  if (mapping) {
+    munmap(mapping, mapping_size);
+  }
+#endif
+}
 
-Result::RootType Result::get_root() const {
-  return root;
+std::string_view Buffer::view() const {
+  return data;
 }
 
-std::string Result::get_config() const {
-  return config;
+bool Buffer::is_mapped() const {
+  return mapping != nullptr || (parent && parent->is_mapped());
 }
 
-std::vector<Error> Result::get_errors() const {
-  return errors;
+Arena::Arena(size_t initial_size) : pool(initial_size > 0 ? initial_size : 4096) {}
+
+std::pmr::memory_resource* Arena::resource() {
+  return &pool;
 }
 
-bool Result::has_errors() const {
-  return !errors.empty();
+std::shared_ptr<Arena> Arena::create(size_t initial_size) {
+  return std::make_shared<Arena>(initial_size);
 }
 
-Result Result::create(Result::RootType values, std::string config, std::vector<Error> errors) {
-  return Result(values, config, errors);
+std::shared_ptr<Buffer> Buffer::own(std::string config) {
+  auto buffer = std::make_shared<Buffer>();
+  buffer->owned = std::move(config);
+  buffer->data = buffer->owned;
+  return buffer;
 }
 
-std::optional<std::shared_ptr<Value>> Result::search(const std::string& key) const {
-  auto parts = utils::split(key, ".");
-  std::shared_ptr<Value> current = nullptr;
-  for (const auto& part : parts) {
-    if (!current) {
-      if (root.find(part) == root.end()) {
-        return std::nullopt;
-      }
-      current = root.at(part);
-    } else {
-      if (!current->is_object()) {
-        return std::nullopt;
-      }
-      auto obj = utils::as<Object>(current);
-      if (!obj->has(part)) {
-        return std::nullopt;
-      }
-      current = obj->get(part).value();
-    }
-  }
-  return current;
+std::shared_ptr<Buffer> Buffer::borrow(std::string_view config) {
+  auto buffer = std::make_shared<Buffer>();
+  buffer->data = config;
+  return buffer;
 }
 
-std::optional<double> Result::get_number(const std::string& key) const {
-  if (auto val = search(key)) {
-    if (val.value()->is_number()) {
-      return utils::as<Number>(val.value())->get_value();
-    }
-  }
-  return std::nullopt;
+std::shared_ptr<Buffer> Buffer::slice(std::shared_ptr<const Buffer> parent, size_t offset, size_t size) {
+  auto buffer = std::make_shared<Buffer>();
+  buffer->data = parent->view().substr(offset, size);
+  buffer->parent = std::move(parent);
+  return buffer;
 }
 
-std::optional<std::string> Result::get_string(const std::string& key) const {
-  if (auto val = search(key)) {
-    if (val.value()->is_string()) {
-      return utils::as<String>(val.value())->get_value();
-    }
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE
+std::shared_ptr<Buffer> Buffer::map(const std::string& file) {
+#if CONFY_USE_MMAP
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
   }
-  return std::nullopt;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  if (info.st_size == 0) {
+    close(fd);
+    return own("");
+  }
+  auto size = static_cast<size_t>(info.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise(mapping, size, MADV_SEQUENTIAL);
+#endif
+  auto buffer = std::make_shared<Buffer>();
+  buffer->mapping = mapping;
+  buffer->mapping_size = size;
+  buffer->data = std::string_view(static_cast<const char*>(mapping), size);
+  return buffer;
+#else
+  return read(file);
+#endif
+}
+
+std::shared_ptr<Buffer> Buffer::read(const std::string& file) {
+  std::ifstream ifs(file, std::ios::binary);
+  if (!ifs.is_open()) {
+    return nullptr;
+  }
+  return own(std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()));
 }
+#endif
 
-std::optional<std::unordered_map<std::string, std::shared_ptr<Value>>> Result::get_object(const std::string& key) const {
-  if (auto val = search(key)) {
-    if (val.value()->is_object()) {
-      return utils::as<Object>(val.value())->get_values();
-    }
-  }
-  return std::nullopt;
+std::shared_ptr<Number> Number::create(std::shared_ptr<Type> type, double value) {
+  return std::make_shared<Number>(type, value);
 }
 
-std::optional<std::vector<std::shared_ptr<Value>>> Result::get_array(const std::string& key) const {
-  if (auto val = search(key)) {
-    if (val.value()->is_array()) {
-      return utils::as<Array>(val.value())->get_values();
-    }
+namespace parser_internal {
+/**
+ * The top level values of a lazy result (see Options::lazy), found by a
+ * syntax-only pass and built the first time a lookup reaches them. Building
+ * allocates from the result's resource (which is not thread safe for arenas)
+ * and adds errors, so it happens under a lock.
+ */
+class LazyTree {
+public:
+  struct Global {
+    Global(std::string_view key, const Type* type, size_t offset, Error::Position pos, bool use_equals)
+      : key(key), type(type), offset(offset), pos(pos), use_equals(use_equals) {}
+
+    std::string_view key;
+    const Type* type;
+    // Where the value starts, right after its key.
+    size_t offset;
+    Error::Position pos;
+    bool use_equals;
+    bool built = false;
+    std::shared_ptr<Value> value;
+  };
+
+  LazyTree(std::string_view config, std::pmr::memory_resource* resource, size_t max_depth);
+
+  // Called by the syntax-only pass, before any lookup.
+  bool has(std::string_view key) const;
+  void add(std::string_view key, const Type* type, size_t offset, Error::Position pos, bool use_equals);
+  // Resolves a dotted key, building the top level value it starts with. The
+  // returned key lives as long as the tree.
+  std::pair<std::string_view, const Value*> find(std::string_view key);
+  // Builds every value, for what goes over the whole tree.
+  const Result::RootType& complete();
+
+  bool has_errors();
+  // The errors found so far, copied as lookups may add to them meanwhile.
+  std::vector<Error> get_errors();
+  // Builds every value first, the errors do not change anymore after that.
+  const std::vector<Error>& get_complete_errors();
+
+  static void attach(Result& result, std::shared_ptr<LazyTree> lazy);
+
+  std::vector<Error> errors;
+#ifdef CONFY_USE_STATS
+  Probe* probe = nullptr;
+#endif
+private:
+  const Value* build(Global& global);
+
+  std::string_view config;
+  std::pmr::memory_resource* resource;
+  size_t max_depth;
+  std::vector<Global> globals;
+  // The global of each key, duplicates being an error.
+  std::unordered_map<std::string_view, size_t> lookup;
+
+  std::mutex mutex;
+  std::unordered_map<std::string, const Value*> paths;
+  bool is_complete = false;
+  Result::RootType root;
+};
+} // namespace parser_internal
+
+Result::Result(Result::RootType values, std::string config, std::vector<Error> errors)
+  : buffer(Buffer::own(std::move(config))), root(std::move(values)), errors(std::move(errors)),
+    index(std::make_shared<PathIndex>()) {}
+
+Result::Result(Result::RootType values, std::shared_ptr<const Buffer> buffer, std::vector<Error> errors,
+  std::shared_ptr<Arena> arena, std::shared_ptr<const Type> schema)
+  : schema(std::move(schema)), arena(std::move(arena)), buffer(std::move(buffer)), root(std::move(values)), errors(std::move(errors)),
+    index(std::make_shared<PathIndex>()) {}
+
+Result& Result::operator=(const Result& other) {
+  if (this != &other) {
+    *this = Result(other);
   }
-  return std::nullopt;
+  return *this;
+}
+
+Result& Result::operator=(Result&& other) {
+  if (this != &other) {
+    root = std::move(other.root);
+    lazy = std::move(other.lazy);
+    index = std::move(other.index);
+    errors = std::move(other.errors);
+    layers = std::move(other.layers);
+    buffer = std::move(other.buffer);
+#ifdef CONFY_USE_STATS
+    probe = std::move(other.probe);
+#endif
+    arena = std::move(other.arena);
+    schema = std::move(other.schema);
+  }
+  return *this;
 }
 
-double Result::get_number_or(const std::string& key, double def) const {
-  if (auto val = get_number(key)) {
-    return val.value();
-  }
-  return def;
+Result::RootType Result::get_root() const {
+  return get_root_ref();
 }
 
-std::string Result::get_string_or(const std::string& key, std::string def) const {
-  if (auto val = get_string(key)) {
-    return val.value();
-  }
-  return def;
+std::string Result::get_config() const {
+  return std::string(get_config_view());
 }
 
-Error::Position Error::Position::copy() const {
-  return Error::Position {line, column};
+std::string_view Result::get_config_view() const {
+  return buffer ? buffer->view() : std::string_view();
 }
 
-Error::Error(std::string message, Error::Position pos) : message(message), position(pos) {}
+std::vector<Error> Result::get_errors() const {
+  return lazy ? lazy->get_errors() : errors;
+}
 
-std::string Error::get_message() const {
-  return message;
+const Result::RootType& Result::get_root_ref() const {
+  return lazy ? lazy->complete() : root;
 }
 
-Error::Position Error::get_position() const {
-  return position;
+const std::vector<Error>& Result::get_errors_ref() const {
+  return lazy ? lazy->get_complete_errors() : errors;
 }
 
-const char* Error::what() const noexcept {
-  return message.c_str();
+#ifdef CONFY_USE_STATS
+const Stats& Result::stats() const {
+  static const Stats empty;
+  return probe ? probe->stats : empty;
 }
+#endif
 
-std::vector<std::string> utils::split(std::string str, const std::string& delim) {
-  std::vector<std::string> tokens;
-  size_t pos = 0;
-  while ((pos = str.find(delim)) != std::string::npos) {
-    tokens.push_back(str.substr(0, pos));
-    str.erase(0, pos + delim.length());
-  }
-  tokens.push_back(str);
-  return tokens;
+bool Result::has_errors() const {
+  return lazy ? lazy->has_errors() : !errors.empty();
 }
 
-namespace parser_internal {
+Result Result::create(Result::RootType values, std::string config, std::vector<Error> errors) {
+  return Result(std::move(values), std::move(config), std::move(errors));
+}
 
-#define PARSER_NEXT_CHAR() \
-  SKIP_WHITESPACE(false); \
-  if (!(char_index >= config.size())) { \
-    pos.column++; \
-    char_index++; \
-  } \
-
-#define SKIP_WHITESPACE(and_newline) \
-  while (config[char_index] == ' ' || config[char_index] == '\t' || (and_newline && config[char_index] == '\n')) { \
-    pos.column++; \
-    if (config[char_index] == '\n') { \
-      pos.line++; \
-      pos.column = 1; \
-    } \
-    char_index++; \
-  } \
-  if (config[char_index] == '#') { \
-    while (config[char_index] != '\n') { \
-      char_index++; \
-    } \
-    pos.line++; \
-    pos.column = 1; \
-    char_index++; \
-  } 
-
-#define PARSER_EXPECT_CHAR(c) \
-  SKIP_WHITESPACE(false); \
-  if (config[char_index] != c) { \
-    return create_error("Expected '" + std::string(1, c) + "' and got '" + std::string(1, config[char_index]) + "'", pos, errors); \
-  } \
-  PARSER_NEXT_CHAR();
-
-#define EXPECT_END_OF_VALUE() \
-  if (!as_value) { \
-    SKIP_WHITESPACE(false); \
-    if (config[char_index] != '\n') { \
-      create_error("Expected '<newline>' and got '" + std::string(1, config[char_index]) + "'", pos, errors); \
-      return std::nullopt; \
-    } \
-    pos.line++; \
-    pos.column = 1; \
-    char_index++; \
-  }
-
-std::optional<std::string> get_identifier(const std::string& config, size_t& char_index, Error::Position& pos) {
-  SKIP_WHITESPACE(true);
-  if (!std::isalpha(config[char_index])) {
-    return std::nullopt;
-  }
-  std::string identifier;
-  while (std::isalnum(config[char_index]) || config[char_index] == '_' || config[char_index] == '-') {
-    identifier += config[char_index];
-    pos.column++;
-    char_index++;
-  }
-  return identifier;
+Result Result::create(Result::RootType values, std::shared_ptr<const Buffer> buffer, std::vector<Error> errors,
+  std::shared_ptr<Arena> arena, std::shared_ptr<const Type> schema) {
+  return Result(std::move(values), std::move(buffer), std::move(errors), std::move(arena), std::move(schema));
 }
 
-bool create_error(const std::string& message, Error::Position& pos, std::vector<Error>& errors) {
-  errors.push_back(Error(message, pos));
-  return EXIT_FAILURE;
+// Whether paths go on into the value: objects by key, and arrays of objects
+// or arrays by index. Arrays of numbers or strings are left whole, which keeps
+// contiguous arrays from creating their elements.
+static bool has_children(const Value* value) {
+  if (value->is_object()) {
+    return true;
+  }
+  if (!value->is_array()) {
+    return false;
+  }
+  auto type = value->get_type_ref();
+  if (!type || !type->is<ArrayType>()) {
+    return false;
+  }
+  const auto& element = static_cast<const ArrayType*>(type)->get();
+  return element && (element->is<ObjectType>() || element->is<ArrayType>());
 }
 
-std::optional<std::shared_ptr<Value>> parse_value(std::shared_ptr<ObjectType> root, const std::string& config, 
-  Result::RootType& values, 
-  std::vector<Error>& errors, Error::Position& pos, 
-  size_t& char_index, const std::optional<std::string>& identifier, bool as_value = false, bool use_equals = true) {
-  SKIP_WHITESPACE(false);
-  auto val_type = root->get(*identifier);
-  if (nullptr == val_type) {
-    create_error("Unknown identifier '" + *identifier + "'", pos, errors);
-    return std::nullopt;
+// The child of a value for which has_children holds, or nullptr.
+static const Value* child_of(const Value* value, std::string_view key) {
+  if (value->is_object()) {
+    return static_cast<const Object*>(value)->find(key);
   }
-  if (use_equals) {
-    if (config[char_index] != '=') {
-      create_error("Expected '=' and got '" + std::string(1, config[char_index]) + "'", pos, errors);
-      return std::nullopt;
-    }
-    PARSER_NEXT_CHAR();
+  size_t index = 0;
+  auto [end, error] = std::from_chars(key.data(), key.data() + key.size(), index);
+  auto elements = static_cast<const Array*>(value)->get_elements();
+  if (error != std::errc() || end != key.data() + key.size() || key.empty() || index >= elements.size()) {
+    return nullptr;
   }
-  SKIP_WHITESPACE(false);
-  if (config[char_index] == '"') {
-    PARSER_NEXT_CHAR();
-    std::string value;
-    while (config[char_index] != '"') {
-      value += config[char_index];
-      pos.column++;
-      char_index++;
-      if (char_index >= config.size()) {
-        create_error("Unexpected end of file", pos, errors);
-        return std::nullopt;
+  return elements[index].get();
+}
+
+struct Result::PathIndex {
+  struct Entry {
+    // The full dotted path, and where its last key starts in it.
+    std::string path;
+    size_t key_start;
+    const Value* value;
+    // One past the last entry of this entry's subtree (entries are stored in preorder).
+    size_t end;
+  };
+
+  std::once_flag built;
+  std::vector<Entry> entries;
+  std::unordered_map<std::string_view, size_t> lookup;
+
+  void add(const std::string& prefix, std::string_view key, const Value* value) {
+    size_t at = entries.size();
+    auto path = prefix.empty() ? std::string(key) : prefix + "." + std::string(key);
+    entries.push_back({path, path.size() - key.size(), value, 0});
+    if (value->is_object()) {
+      for (const auto& [child_key, child] : *static_cast<const Object*>(value)) {
+        add(path, child_key, child.get());
+      }
+    } else if (has_children(value)) {
+      auto elements = static_cast<const Array*>(value)->get_elements();
+      for (size_t i = 0; i < elements.size(); i++) {
+        add(path, std::to_string(i), elements[i].get());
       }
     }
-    PARSER_NEXT_CHAR();
-    if (!val_type->is<StringType>()) {
-      create_error("Expected '" + val_type->name() + "' and got '" + value + "'", pos, errors);
-      return std::nullopt;
-    }
-    EXPECT_END_OF_VALUE();
-    if (auto err = utils::as<StringType>(val_type)->validate(value)) {
-      create_error(err.value(), pos, errors);
-      return std::nullopt;
+    entries[at].end = entries.size();
+  }
+
+  std::string_view key_of(size_t entry) const {
+    return std::string_view(entries[entry].path).substr(entries[entry].key_start);
+  }
+
+  void match(size_t begin, size_t end, const std::vector<std::string_view>& segments, size_t depth, std::vector<size_t>& out) const {
+    for (size_t i = begin; i < end; i = entries[i].end) {
+      if (segments[depth] != "*" && segments[depth] != key_of(i)) {
+        continue;
+      }
+      if (depth + 1 == segments.size()) {
+        out.push_back(i);
+      } else {
+        match(i + 1, entries[i].end, segments, depth + 1, out);
+      }
+    }
+  }
+};
+
+const Result::PathIndex& Result::get_index() const {
+  std::call_once(index->built, [this] {
+    for (const auto& [key, value] : get_root_ref()) {
+      index->add("", key, value.get());
+    }
+    // Only point into the paths once the entries stopped moving around.
+    index->lookup.reserve(index->entries.size());
+    for (size_t i = 0; i < index->entries.size(); i++) {
+      index->lookup.emplace(index->entries[i].path, i);
+    }
+  });
+  return *index;
+}
+
+Result::Path::Path(std::string_view key, const Value* value) : key(key), value(value) {}
+
+bool Result::Path::is_valid() const {
+  return value != nullptr;
+}
+
+std::string_view Result::Path::get_key() const {
+  return key;
+}
+
+const Value* Result::Path::get_value() const {
+  return value;
+}
+
+Result::Path Result::compile_path(std::string_view key) const {
+  if (lazy) {
+    auto [path, value] = lazy->find(key);
+    return value ? Path(path, value) : Path();
+  }
+  const auto& paths = get_index();
+  auto it = paths.lookup.find(key);
+  if (it == paths.lookup.end()) {
+    return Path();
+  }
+  const auto& entry = paths.entries[it->second];
+  return Path(entry.path, entry.value);
+}
+
+std::vector<Result::Path> Result::query(std::string_view pattern) const {
+  const auto& paths = get_index();
+  std::vector<std::string_view> segments;
+  size_t start = 0;
+  while (true) {
+    auto dot = pattern.find('.', start);
+    segments.push_back(pattern.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start));
+    if (dot == std::string_view::npos) {
+      break;
+    }
+    start = dot + 1;
+  }
+  std::vector<Path> result;
+  if (pattern.find('*') == std::string_view::npos) {
+    if (auto path = compile_path(pattern); path.is_valid()) {
+      result.push_back(path);
+    }
+    return result;
+  }
+  std::vector<size_t> matches;
+  paths.match(0, paths.entries.size(), segments, 0, matches);
+  result.reserve(matches.size());
+  for (auto i : matches) {
+    result.push_back(Path(paths.entries[i].path, paths.entries[i].value));
+  }
+  return result;
+}
+
+// Deep comparison, used to diff results.
+static bool same_value(const Value* a, const Value* b) {
+  if (a->get_kind() != b->get_kind()) {
+    return false;
+  }
+  switch (a->get_kind()) {
+    case Kind::String:
+      return static_cast<const String*>(a)->get_view() == static_cast<const String*>(b)->get_view();
+    case Kind::Number:
+      return static_cast<const Number*>(a)->get_value() == static_cast<const Number*>(b)->get_value();
+    case Kind::Object: {
+      auto object = static_cast<const Object*>(b);
+      if (static_cast<const Object*>(a)->size() != object->size()) {
+        return false;
+      }
+      for (const auto& [key, value] : *static_cast<const Object*>(a)) {
+        auto other = object->find(key);
+        if (!other || !same_value(value.get(), other)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case Kind::Array: {
+      auto left_array = static_cast<const Array*>(a);
+      auto right_array = static_cast<const Array*>(b);
+      if (left_array->size() != right_array->size()) {
+        return false;
+      }
+      // Compare contiguous arrays without creating their elements.
+      auto left_numbers = left_array->get_numbers();
+      auto right_numbers = right_array->get_numbers();
+      if (!left_numbers.empty() && !right_numbers.empty()) {
+        return std::equal(left_numbers.begin(), left_numbers.end(), right_numbers.begin());
+      }
+      auto left = left_array->get_elements();
+      auto right = right_array->get_elements();
+      for (size_t i = 0; i < left.size(); i++) {
+        if (!same_value(left[i].get(), right[i].get())) {
+          return false;
+        }
+      }
+      return true;
+    }
+    default:
+      return a == b;
+  }
+}
+
+std::vector<std::string> Result::diff(const Result& other) const {
+  const auto& paths = get_index();
+  const auto& other_paths = other.get_index();
+  std::vector<std::string> changed;
+  for (const auto& entry : paths.entries) {
+    auto it = other_paths.lookup.find(entry.path);
+    if (it == other_paths.lookup.end()) {
+      changed.push_back(entry.path);
+      continue;
+    }
+    auto value = other_paths.entries[it->second].value;
+    // Values with children on both sides are compared through their entries.
+    if (!(has_children(entry.value) && has_children(value)) && !same_value(entry.value, value)) {
+      changed.push_back(entry.path);
+    }
+  }
+  for (const auto& entry : other_paths.entries) {
+    if (paths.lookup.find(entry.path) == paths.lookup.end()) {
+      changed.push_back(entry.path);
+    }
+  }
+  return changed;
+}
+
+std::optional<double> Result::get_number(const Path& path) const {
+  if (path.value && path.value->is_number()) {
+    return static_cast<const Number*>(path.value)->get_value();
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> Result::get_string(const Path& path) const {
+  if (path.value && path.value->is_string()) {
+    return static_cast<const String*>(path.value)->get_value();
+  }
+  return std::nullopt;
+}
+
+std::optional<std::unordered_map<std::string, std::shared_ptr<Value>>> Result::get_object(const Path& path) const {
+  if (path.value && path.value->is_object()) {
+    return static_cast<const Object*>(path.value)->get_values();
+  }
+  return std::nullopt;
+}
+
+std::optional<std::vector<std::shared_ptr<Value>>> Result::get_array(const Path& path) const {
+  if (path.value && path.value->is_array()) {
+    return static_cast<const Array*>(path.value)->get_values();
+  }
+  return std::nullopt;
+}
+
+double Result::get_number_or(const Path& path, double def) const {
+  if (auto val = get_number(path)) {
+    return val.value();
+  }
+  return def;
+}
+
+std::string Result::get_string_or(const Path& path, std::string def) const {
+  if (auto val = get_string(path)) {
+    return val.value();
+  }
+  return def;
+}
+
+std::optional<std::string_view> Result::get_string_view(const Path& path) const {
+  if (path.value && path.value->is_string()) {
+    return static_cast<const String*>(path.value)->get_view();
+  }
+  return std::nullopt;
+}
+
+const Object* Result::get_object_ref(const Path& path) const {
+  if (path.value && path.value->is_object()) {
+    return static_cast<const Object*>(path.value);
+  }
+  return nullptr;
+}
+
+const Array* Result::get_array_ref(const Path& path) const {
+  if (path.value && path.value->is_array()) {
+    return static_cast<const Array*>(path.value);
+  }
+  return nullptr;
+}
+
+std::optional<std::string_view> Result::get_string_view(const std::string& key) const {
+  return get_string_view(compile_path(key));
+}
+
+const Object* Result::get_object_ref(const std::string& key) const {
+  return get_object_ref(compile_path(key));
+}
+
+const Array* Result::get_array_ref(const std::string& key) const {
+  return get_array_ref(compile_path(key));
+}
+
+std::optional<double> Result::get_number(const std::string& key) const {
+  return get_number(compile_path(key));
+}
+
+std::optional<std::string> Result::get_string(const std::string& key) const {
+  return get_string(compile_path(key));
+}
+
+std::optional<std::unordered_map<std::string, std::shared_ptr<Value>>> Result::get_object(const std::string& key) const {
+  return get_object(compile_path(key));
+}
+
+std::optional<std::vector<std::shared_ptr<Value>>> Result::get_array(const std::string& key) const {
+  return get_array(compile_path(key));
+}
+
+double Result::get_number_or(const std::string& key, double def) const {
+  return get_number_or(compile_path(key), def);
+}
+
+std::string Result::get_string_or(const std::string& key, std::string def) const {
+  return get_string_or(compile_path(key), std::move(def));
+}
+
+Error::Position Error::Position::copy() const {
+  return Error::Position {line, column};
+}
+
+Error::Error(std::string message, Error::Position pos) : message(message), position(pos) {}
+
+std::string Error::get_message() const {
+  return message;
+}
+
+Error::Position Error::get_position() const {
+  return position;
+}
+
+const char* Error::what() const noexcept {
+  return message.c_str();
+}
+
+std::vector<std::string> utils::split(std::string str, const std::string& delim) {
+  std::vector<std::string> tokens;
+  size_t pos = 0;
+  while ((pos = str.find(delim)) != std::string::npos) {
+    tokens.push_back(str.substr(0, pos));
+    str.erase(0, pos + delim.length());
+  }
+  tokens.push_back(str);
+  return tokens;
+}
+
+namespace parser_internal {
+
+/**
+ * Bulk scanning: each character class can test 32 (AVX2), 16 (SSE2) or
+ * 1 character at a time, and `find` returns the index of the first
+ * character at or after `from` that is (or, for `skip`, is not) in it.
+ */
+namespace scan {
+
+#if defined(CONFY_SIMD_SSE2) || defined(CONFY_SIMD_AVX2)
+inline unsigned count_trailing_zeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+#define CONFY_SCAN_CLASS(Name, scalar_test, simd_test) \
+  struct Name { \
+    static bool scalar(char c) { return scalar_test; } \
+    CONFY_SCAN_SSE2(simd_test) \
+    CONFY_SCAN_AVX2(simd_test) \
+  };
+
+#ifdef CONFY_SIMD_SSE2
+#define CONFY_SCAN_SSE2(simd_test) \
+  static __m128i sse2(__m128i c) { \
+    using V = __m128i; \
+    auto eq = [](V a, char b) { return _mm_cmpeq_epi8(a, _mm_set1_epi8(b)); }; \
+    auto range = [](V a, char lo, char hi) { \
+      return _mm_and_si128(_mm_cmpgt_epi8(a, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(a, _mm_set1_epi8(hi + 1))); \
+    }; \
+    auto any = [](V a, V b) { return _mm_or_si128(a, b); }; \
+    (void) eq; (void) range; (void) any; \
+    return simd_test; \
+  }
+#else
+#define CONFY_SCAN_SSE2(simd_test)
+#endif
+
+#ifdef CONFY_SIMD_AVX2
+#define CONFY_SCAN_AVX2(simd_test) \
+  static __m256i avx2(__m256i c) { \
+    using V = __m256i; \
+    auto eq = [](V a, char b) { return _mm256_cmpeq_epi8(a, _mm256_set1_epi8(b)); }; \
+    auto range = [](V a, char lo, char hi) { \
+      return _mm256_and_si256(_mm256_cmpgt_epi8(a, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), a)); \
+    }; \
+    auto any = [](V a, V b) { return _mm256_or_si256(a, b); }; \
+    (void) eq; (void) range; (void) any; \
+    return simd_test; \
+  }
+#else
+#define CONFY_SCAN_AVX2(simd_test)
+#endif
+
+// Characters >= 0x80 are negative for the signed SIMD compares, so they never
+// fall in the ranges below, just like for the scalar tests.
+CONFY_SCAN_CLASS(Blank, c == ' ' || c == '\t', any(eq(c, ' '), eq(c, '\t')))
+CONFY_SCAN_CLASS(QuoteOrNewline, c == '"' || c == '\n', any(eq(c, '"'), eq(c, '\n')))
+CONFY_SCAN_CLASS(NumberChar, (c >= '0' && c <= '9') || c == '.', any(range(c, '0', '9'), eq(c, '.')))
+CONFY_SCAN_CLASS(IdentifierChar,
+  (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-',
+  any(any(range(c, 'a', 'z'), range(c, 'A', 'Z')), any(range(c, '0', '9'), any(eq(c, '_'), eq(c, '-')))))
+
+#undef CONFY_SCAN_CLASS
+#undef CONFY_SCAN_SSE2
+#undef CONFY_SCAN_AVX2
+
+template <typename Class, bool in_class>
+size_t find_first(std::string_view text, size_t from) {
+  const char* data = text.data();
+  size_t size = text.size();
+  size_t i = from;
+#ifdef CONFY_SIMD_AVX2
+  for (; i + 32 <= size; i += 32) {
+    auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(Class::avx2(chars)));
+    if (!in_class) {
+      mask = ~mask;
+    }
+    if (mask) {
+      return i + count_trailing_zeros(mask);
+    }
+  }
+#endif
+#ifdef CONFY_SIMD_SSE2
+  for (; i + 16 <= size; i += 16) {
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(Class::sse2(chars)));
+    if (!in_class) {
+      mask = ~mask & 0xFFFF;
+    }
+    if (mask) {
+      return i + count_trailing_zeros(mask);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    if (Class::scalar(data[i]) == in_class) {
+      return i;
+    }
+  }
+  return size;
+}
+
+template <typename Class>
+size_t find(std::string_view text, size_t from) {
+  return find_first<Class, true>(text, from);
+}
+
+template <typename Class>
+size_t skip(std::string_view text, size_t from) {
+  return find_first<Class, false>(text, from);
+}
+
+inline size_t find_char(std::string_view text, size_t from, char c) {
+  if (from >= text.size()) {
+    return text.size();
+  }
+  auto found = static_cast<const char*>(std::memchr(text.data() + from, c, text.size() - from));
+  return found ? static_cast<size_t>(found - text.data()) : text.size();
+}
+
+} // namespace scan
+
+#ifdef CONFY_USE_STATS
+Probe::Probe(std::pmr::memory_resource* upstream, Hooks* hooks) : upstream(upstream), hooks(hooks) {}
+
+void Probe::enter(const Type& type, const Error::Position& pos) {
+  if (hooks) {
+    hooks->on_value_begin(type, pos);
+  }
+  stats.max_depth = std::max(stats.max_depth, ++depth);
+}
+
+void Probe::exit(const Type& type, const Value* value) {
+  depth--;
+  if (value) {
+    count(value->get_kind(), 1);
+  }
+  if (hooks) {
+    hooks->on_value_end(type, value != nullptr);
+  }
+}
+
+void Probe::count(Kind kind, size_t values) {
+  switch (kind) {
+    case Kind::String: stats.strings += values; break;
+    case Kind::Number: stats.numbers += values; break;
+    case Kind::Object: stats.objects += values; break;
+    case Kind::Array: stats.arrays += values; break;
+    default: break;
+  }
+}
+
+void Probe::attach(Result& result, std::shared_ptr<Probe> probe) {
+  result.probe = std::move(probe);
+}
+
+void Probe::set_read_time(Result& result, Clock::duration time) {
+  if (result.probe) {
+    result.probe->stats.read_time = std::chrono::duration_cast<Stats::Duration>(time);
+  }
+}
+
+void* Probe::do_allocate(size_t bytes, size_t alignment) {
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.allocations++;
+  stats.allocated_bytes += bytes;
+  return upstream->allocate(bytes, alignment);
+}
+
+void Probe::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+  std::lock_guard<std::mutex> lock(mutex);
+  upstream->deallocate(ptr, bytes, alignment);
+}
+
+bool Probe::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+#endif
+
+Lexer::Lexer(std::string_view config, std::vector<Error>& errors)
+  : config(config), pos({1, 1}), errors(errors) {}
+
+// Reads past the end of the configuration yield '\0', as the buffer is not
+// guaranteed to be null terminated (e.g. when it is memory-mapped).
+char Lexer::peek() const {
+  return char_index < config.size() ? config[char_index] : '\0';
+}
+
+bool Lexer::at_end() const {
+  return char_index >= config.size();
+}
+
+void Lexer::skip_whitespace(bool and_newline) {
+  while (true) {
+    auto end = scan::skip<scan::Blank>(config, char_index);
+    pos.column += static_cast<int>(end - char_index);
+    char_index = end;
+    if (and_newline && peek() == '\n') {
+      pos.line++;
+      pos.column = 1;
+      char_index++;
+      continue;
+    }
+    if (peek() != '#') {
+      return;
+    }
+    // Comments run until the end of the line, which is left for the caller
+    // unless we are skipping newlines anyway.
+    end = scan::find_char(config, char_index, '\n');
+    pos.column += static_cast<int>(end - char_index);
+    char_index = end;
+    if (!and_newline) {
+      return;
+    }
+  }
+}
+
+void Lexer::next() {
+  skip_whitespace(false);
+  if (!at_end()) {
+    pos.column++;
+    char_index++;
+  }
+}
+
+bool Lexer::expect_end_of_value() {
+  skip_whitespace(false);
+  if (peek() != '\n' && !at_end()) {
+    error("Expected '<newline>' and got '" + std::string(1, peek()) + "'");
+    return false;
+  }
+  pos.line++;
+  pos.column = 1;
+  if (!at_end()) {
+    char_index++;
+  }
+  return true;
+}
+
+std::optional<std::string_view> Lexer::identifier() {
+  skip_whitespace(true);
+  char first = peek();
+  if (!((first >= 'a' && first <= 'z') || (first >= 'A' && first <= 'Z'))) {
+    return std::nullopt;
+  }
+  size_t start = char_index;
+  char_index = scan::skip<scan::IdentifierChar>(config, char_index + 1);
+  pos.column += static_cast<int>(char_index - start);
+  return config.substr(start, char_index - start);
+}
+
+bool Lexer::is_number() const {
+  return peek() >= '0' && peek() <= '9';
+}
+
+std::optional<std::string_view> Lexer::string() {
+  next();
+  size_t start = char_index;
+  while (true) {
+    auto end = scan::find<scan::QuoteOrNewline>(config, char_index);
+    pos.column += static_cast<int>(end - char_index);
+    char_index = end;
+    if (at_end()) {
+      error("Unexpected end of file");
+      return std::nullopt;
+    }
+    if (peek() == '"') {
+      break;
+    }
+    pos.line++;
+    pos.column = 1;
+    char_index++;
+  }
+  auto value = config.substr(start, char_index - start);
+  next();
+  return value;
+}
+
+// Converts the whole of `text`, with strtod where floating point from_chars is missing.
+std::optional<double> to_number(std::string_view text) {
+  double value = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), value);
+  bool valid = err == std::errc() && end == text.data() + text.size();
+#else
+  std::string copy(text);
+  char* end = nullptr;
+  value = std::strtod(copy.c_str(), &end);
+  bool valid = end == copy.c_str() + copy.size();
+#endif
+  if (!valid) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<double> Lexer::number() {
+  size_t start = char_index;
+  char_index = scan::skip<scan::NumberChar>(config, char_index);
+  auto text = config.substr(start, char_index - start);
+  auto value = to_number(text);
+  if (!value) {
+    error("Invalid number '" + std::string(text) + "'");
+    return std::nullopt;
+  }
+  pos.column += static_cast<int>(text.size());
+  return value;
+}
+
+bool Lexer::error(const std::string& message) {
+  errors.push_back(Error(message, pos));
+  return EXIT_FAILURE;
+}
+
+std::string Lexer::describe() const {
+  return std::string(1, peek());
+}
+
+template <typename T, typename... Args>
+std::shared_ptr<T> make_value(std::pmr::memory_resource* resource, Args&&... args) {
+  return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(resource), std::forward<Args>(args)...);
+}
+
+// Validator calls go through the probe when instrumentation is enabled.
+#ifdef CONFY_USE_STATS
+#define CONFY_VALIDATE(lexer, type, ...) \
+  ((lexer).probe ? (lexer).probe->validate(type, [&] { return __VA_ARGS__; }) : (__VA_ARGS__))
+#else
+#define CONFY_VALIDATE(lexer, type, ...) (__VA_ARGS__)
+#endif
+
+/**
+ * Builds value trees without recursion. The objects and arrays being read
+ * are kept on an explicit stack, reused for every top level value, so each
+ * level of nesting costs a frame of heap memory instead of native stack, and
+ * nesting is bounded by Options::max_depth.
+ *
+ * Without a type (nullptr), values are only checked for syntax and nothing
+ * is built, which is how lazy results find their top level values.
+ */
+class TreeBuilder {
+public:
+  TreeBuilder(Lexer& lexer, std::pmr::memory_resource* resource, size_t max_depth);
+
+  // Reads a value of the given type, preceded by '=' if `use_equals` is set.
+  std::optional<std::shared_ptr<Value>> parse(const Type* type, bool use_equals);
+private:
+  struct Frame {
+    Frame(const Type* type, bool is_object, bool as_value, std::pmr::memory_resource* resource);
+
+    const Type* type;
+    bool is_object;
+    // Array elements are not followed by a newline.
+    bool as_value;
+    // Whether an element has been read, for arrays.
+    bool started = false;
+    // The slot of the entry being read in the object's type, for objects.
+    size_t slot = 0;
+    Object::Slots entries;
+    Array::Values elements;
+  };
+
+  enum class Step { Failed, Value, Pushed };
+
+  // Reads a value into `value`, or pushes a frame for an object or array.
+  Step start(const Type* type, bool as_value, bool use_equals);
+  Step read(const Type* type, bool as_value, bool use_equals);
+  // Reads arrays of numbers or strings straight into contiguous storage.
+  Step read_contiguous(const Type* type, const Type* element_type, bool as_value);
+  // Starts the next entry or element of the innermost container, or closes it.
+  Step next();
+  Step close();
+  // Adds `value` to the innermost container.
+  bool add();
+  // Drops the containers left open by an error.
+  void unwind();
+
+  Lexer& lexer;
+  std::pmr::memory_resource* resource;
+  size_t max_depth;
+  std::vector<Frame> stack;
+  std::shared_ptr<Value> value;
+};
+
+TreeBuilder::Frame::Frame(const Type* type, bool is_object, bool as_value, std::pmr::memory_resource* resource)
+  : type(type), is_object(is_object), as_value(as_value), entries(resource), elements(resource) {
+  if (is_object && type) {
+    entries.resize(utils::as<const ObjectType>(type)->size());
+  }
+}
+
+TreeBuilder::TreeBuilder(Lexer& lexer, std::pmr::memory_resource* resource, size_t max_depth)
+  : lexer(lexer), resource(resource), max_depth(max_depth) {
+  stack.reserve(std::min<size_t>(max_depth, 16));
+}
+
+std::optional<std::shared_ptr<Value>> TreeBuilder::parse(const Type* type, bool use_equals) {
+  auto step = start(type, false, use_equals);
+  while (true) {
+    if (step == Step::Failed) {
+      unwind();
+      return std::nullopt;
+    }
+    if (step == Step::Value) {
+      if (stack.empty()) {
+        return std::move(value);
+      }
+      if (!add()) {
+        unwind();
+        return std::nullopt;
+      }
+    }
+    step = next();
+  }
+}
+
+TreeBuilder::Step TreeBuilder::start(const Type* type, bool as_value, bool use_equals) {
+  if (stack.size() >= max_depth) {
+    lexer.error("Values can not be nested more than " + std::to_string(max_depth) + " levels deep");
+    return Step::Failed;
+  }
+  CONFY_STATS(if (lexer.probe && type) {
+    lexer.probe->enter(*type, lexer.pos);
+  })
+  auto step = read(type, as_value, use_equals);
+  CONFY_STATS(if (lexer.probe && type && step != Step::Pushed) {
+    lexer.probe->exit(*type, step == Step::Value ? value.get() : nullptr);
+  })
+  return step;
+}
+
+TreeBuilder::Step TreeBuilder::read(const Type* val_type, bool as_value, bool use_equals) {
+  lexer.skip_whitespace(false);
+  if (use_equals) {
+    if (lexer.peek() != '=') {
+      lexer.error("Expected '=' and got '" + lexer.describe() + "'");
+      return Step::Failed;
+    }
+    lexer.next();
+  }
+  lexer.skip_whitespace(false);
+  if (lexer.peek() == '"') {
+    auto string = lexer.string();
+    if (!string) {
+      return Step::Failed;
+    }
+    if (val_type && !val_type->is<StringType>()) {
+      lexer.error("Expected '" + val_type->name() + "' and got '" + std::string(*string) + "'");
+      return Step::Failed;
+    }
+    if (!as_value && !lexer.expect_end_of_value()) {
+      return Step::Failed;
+    }
+    if (!val_type) {
+      return Step::Value;
+    }
+    if (auto err = CONFY_VALIDATE(lexer, *val_type, utils::as<const StringType>(val_type)->validate(std::string(*string)))) {
+      lexer.error(err.value());
+      return Step::Failed;
+    }
+    value = make_value<String>(resource, val_type, *string, true);
+    return Step::Value;
+  } else if (lexer.is_number()) {
+    auto num = lexer.number();
+    if (!num) {
+      return Step::Failed;
+    }
+    if (val_type && !val_type->is<NumType>()) {
+      lexer.error("Expected '" + val_type->name() + "' and got 'number'");
+      return Step::Failed;
+    }
+    if (!as_value && !lexer.expect_end_of_value()) {
+      return Step::Failed;
+    }
+    if (!val_type) {
+      return Step::Value;
+    }
+    if (auto err = CONFY_VALIDATE(lexer, *val_type, utils::as<const NumType>(val_type)->validate(*num))) {
+      lexer.error(err.value());
+      return Step::Failed;
+    }
+    value = make_value<Number>(resource, val_type, *num);
+    return Step::Value;
+  } else if (lexer.peek() == '{') {
+    lexer.next();
+    if (lexer.peek() != '\n') {
+      lexer.error("Expected '<newline>' and got '" + lexer.describe() + "'");
+      return Step::Failed;
+    }
+    if (val_type && !val_type->is<ObjectType>()) {
+      lexer.error("Expected '" + val_type->name() + "' and got 'object'");
+      return Step::Failed;
+    }
+    stack.emplace_back(val_type, true, as_value, resource);
+    return Step::Pushed;
+  } else if (lexer.peek() == '[') {
+    lexer.next();
+    if (val_type && !val_type->is<ArrayType>()) { // TODO: Check for array subtypes
+      lexer.error("Expected '" + val_type->name() + "' and got 'array'");
+      return Step::Failed;
+    }
+    const auto* element_type = val_type ? utils::as<const ArrayType>(val_type)->get().get() : nullptr;
+    // Elements one level past Options::max_depth are left to start() to report.
+    if (element_type && stack.size() + 1 < max_depth
+      && (element_type->is<NumType>() || (element_type->is<StringType>() && lexer.config.size() <= UINT32_MAX))) {
+      return read_contiguous(val_type, element_type, as_value);
+    }
+    lexer.skip_whitespace(false);
+    stack.emplace_back(val_type, false, as_value, resource);
+    return Step::Pushed;
+  }
+  lexer.error("Expected a valid value but found '" + lexer.describe() + "'");
+  return Step::Failed;
+}
+
+// Numbers and strings are read straight into contiguous storage (strings as
+// offsets into the buffer), and validated all at once after the whole array is read.
+TreeBuilder::Step TreeBuilder::read_contiguous(const Type* val_type, const Type* element_type, bool as_value) {
+  bool is_number = element_type->is<NumType>();
+  Array::Numbers numbers(resource);
+  Array::Strings strings(resource);
+  auto& positions = lexer.positions;
+  positions.clear();
+  lexer.skip_whitespace(false);
+  while (lexer.peek() != ']') {
+    lexer.skip_whitespace(false);
+    if (is_number && lexer.is_number()) {
+      auto num = lexer.number();
+      if (!num) {
+        return Step::Failed;
+      }
+      numbers.push_back(*num);
+      positions.push_back(lexer.pos);
+    } else if (!is_number && lexer.peek() == '"') {
+      auto string = lexer.string();
+      if (!string) {
+        return Step::Failed;
+      }
+      auto offset = static_cast<uint32_t>(string->data() - lexer.config.data());
+      strings.push_back({offset, static_cast<uint32_t>(string->size())});
+      positions.push_back(lexer.pos);
+    } else {
+      // Anything else is an error, reported by reading it as a single element.
+      auto step = start(element_type, true, false);
+      CONFY_ASSERT(step == Step::Failed, "Only numbers or strings can be elements of this array");
+      (void)step;
+      return Step::Failed;
+    }
+    lexer.skip_whitespace(false);
+    if (lexer.peek() == ',') {
+      lexer.next();
+      continue;
+    }
+    if (lexer.peek() != ']') {
+      lexer.error("Expected ',' or ']' and got '" + lexer.describe() + "'");
+      return Step::Failed;
+    }
+  }
+  std::optional<std::pair<size_t, std::string>> err;
+  if (is_number) {
+    err = CONFY_VALIDATE(lexer, *element_type,
+      utils::as<const NumType>(element_type)->validate_each(Span<const double>(numbers.data(), numbers.size())));
+  } else {
+    auto& views = lexer.views;
+    views.clear();
+    for (const auto& slice : strings) {
+      views.push_back(lexer.config.substr(slice.offset, slice.size));
+    }
+    err = CONFY_VALIDATE(lexer, *element_type,
+      utils::as<const StringType>(element_type)->validate_each(Span<const std::string_view>(views.data(), views.size())));
+  }
+  if (err) {
+    lexer.pos = positions[err->first];
+    lexer.error(err->second);
+    return Step::Failed;
+  }
+  lexer.next();
+  if (!as_value && !lexer.expect_end_of_value()) {
+    return Step::Failed;
+  }
+  CONFY_STATS(if (lexer.probe) {
+    lexer.probe->count(Kind::Number, numbers.size());
+    lexer.probe->count(Kind::String, strings.size());
+  })
+  if (is_number) {
+    value = make_value<Array>(resource, val_type, std::move(numbers));
+  } else {
+    value = make_value<Array>(resource, val_type, lexer.config.data(), std::move(strings));
+  }
+  return Step::Value;
+}
+
+TreeBuilder::Step TreeBuilder::next() {
+  auto& frame = stack.back();
+  if (frame.is_object) {
+    // Blank and comment lines can come before the closing brace.
+    lexer.skip_whitespace(true);
+    if (lexer.peek() == '}') {
+      return close();
+    }
+    auto identifier = lexer.identifier();
+    if (!identifier) {
+      lexer.error("Expected identifier and got '" + lexer.describe() + "'");
+      return Step::Failed;
+    }
+    lexer.skip_whitespace(false);
+    if (!frame.type) {
+      return start(nullptr, false, true);
+    }
+    const auto* object_type = utils::as<const ObjectType>(frame.type);
+    frame.slot = object_type->slot(*identifier);
+    if (frame.slot == object_type->size()) {
+      lexer.error("Unknown identifier '" + std::string(*identifier) + "'");
+      return Step::Failed;
+    }
+    if (frame.entries[frame.slot]) {
+      lexer.error("Duplicate identifier '" + std::string(*identifier) + "'");
+      return Step::Failed;
+    }
+    return start(object_type->at(frame.slot).second.get(), false, true);
+  }
+  if (frame.started) {
+    lexer.skip_whitespace(false);
+    if (lexer.peek() == ',') {
+      lexer.next();
+    } else if (lexer.peek() != ']') {
+      lexer.error("Expected ',' or ']' and got '" + lexer.describe() + "'");
+      return Step::Failed;
+    }
+  }
+  frame.started = true;
+  if (lexer.peek() == ']') {
+    return close();
+  }
+  lexer.skip_whitespace(false);
+  return start(frame.type ? utils::as<const ArrayType>(frame.type)->get().get() : nullptr, true, false);
+}
+
+TreeBuilder::Step TreeBuilder::close() {
+  auto& frame = stack.back();
+  lexer.next();
+  if (!frame.as_value && !lexer.expect_end_of_value()) {
+    return Step::Failed;
+  }
+  if (!frame.type) {
+    value = nullptr;
+  } else if (frame.is_object) {
+    value = make_value<Object>(resource, frame.type, std::move(frame.entries));
+  } else {
+    value = make_value<Array>(resource, frame.type, std::move(frame.elements));
+  }
+  CONFY_STATS(if (lexer.probe && frame.type) {
+    lexer.probe->exit(*frame.type, value.get());
+  })
+  stack.pop_back();
+  return Step::Value;
+}
+
+bool TreeBuilder::add() {
+  auto& frame = stack.back();
+  if (!frame.type) {
+    return true;
+  }
+  if (!frame.is_object) {
+    frame.elements.push_back(std::move(value));
+    return true;
+  }
+  frame.entries[frame.slot] = std::move(value);
+  return true;
+}
+
+void TreeBuilder::unwind() {
+  while (!stack.empty()) {
+    CONFY_STATS(if (lexer.probe && stack.back().type) {
+      lexer.probe->exit(*stack.back().type, nullptr);
+    })
+    stack.pop_back();
+  }
+  value = nullptr;
+}
+
+bool parse_global_rule(const ObjectType* root, Lexer& lexer,
+  Result::RootType& values, TreeBuilder& builder) {
+  Error::Position copy_pos = lexer.pos;
+  auto identifier = lexer.identifier();
+  if (!identifier) {
+    return lexer.error("Expected identifier and got '" + lexer.describe() + "'");
+  }
+
+  auto entry = root->find(*identifier);
+  if (!entry) {
+    lexer.pos = copy_pos;
+    return lexer.error("Unknown identifier '" + std::string(*identifier) + "'");
+  }
+  if (values.find(std::string(*identifier)) != values.end()) {
+    lexer.pos = copy_pos;
+    return lexer.error("Duplicate identifier '" + std::string(*identifier) + "'");
+  }
+
+  lexer.skip_whitespace(false);
+  // Objects can be declared either as `name = {` or as `name {`.
+  auto val = builder.parse(entry->second.get(), lexer.peek() != '{');
+  if (!val) {
+    return EXIT_FAILURE;
+  }
+  values.insert(std::make_pair(std::string(*identifier), *val));
+  return EXIT_SUCCESS;
+}
+
+bool parse_global(const ObjectType* root, Lexer& lexer,
+  Result::RootType& values, TreeBuilder& builder) {
+  lexer.skip_whitespace(true);
+  if (lexer.at_end() || lexer.peek() == 0) {
+    return EXIT_FAILURE; // End the loop
+  }
+  return parse_global_rule(root, lexer, values, builder);
+}
+
+// Records where the next top level value of a lazy result starts, and only checks its syntax.
+bool index_global(const ObjectType* root, Lexer& lexer, LazyTree& lazy, TreeBuilder& checker) {
+  lexer.skip_whitespace(true);
+  if (lexer.at_end() || lexer.peek() == 0) {
+    return EXIT_FAILURE; // End the loop
+  }
+  Error::Position copy_pos = lexer.pos;
+  auto identifier = lexer.identifier();
+  if (!identifier) {
+    return lexer.error("Expected identifier and got '" + lexer.describe() + "'");
+  }
+  auto entry = root->find(*identifier);
+  if (!entry) {
+    lexer.pos = copy_pos;
+    return lexer.error("Unknown identifier '" + std::string(*identifier) + "'");
+  }
+  if (lazy.has(*identifier)) {
+    lexer.pos = copy_pos;
+    return lexer.error("Duplicate identifier '" + std::string(*identifier) + "'");
+  }
+  lexer.skip_whitespace(false);
+  bool use_equals = lexer.peek() != '{';
+  size_t offset = lexer.char_index;
+  Error::Position pos = lexer.pos;
+  if (!checker.parse(nullptr, use_equals)) {
+    return EXIT_FAILURE;
+  }
+  lazy.add(*identifier, entry->second.get(), offset, pos, use_equals);
+  return EXIT_SUCCESS;
+}
+
+LazyTree::LazyTree(std::string_view config, std::pmr::memory_resource* resource, size_t max_depth)
+  : config(config), resource(resource), max_depth(max_depth) {}
+
+bool LazyTree::has(std::string_view key) const {
+  return lookup.find(key) != lookup.end();
+}
+
+void LazyTree::add(std::string_view key, const Type* type, size_t offset, Error::Position pos, bool use_equals) {
+  lookup.emplace(key, globals.size());
+  globals.emplace_back(key, type, offset, pos, use_equals);
+}
+
+const Value* LazyTree::build(Global& global) {
+  if (!global.built) {
+    global.built = true;
+    std::vector<Error> found;
+    Lexer lexer(config, found);
+    lexer.char_index = global.offset;
+    lexer.pos = global.pos;
+    CONFY_STATS(lexer.probe = probe;)
+    TreeBuilder builder(lexer, resource, max_depth);
+    if (auto value = builder.parse(global.type, global.use_equals)) {
+      global.value = std::move(*value);
+    }
+    errors.insert(errors.end(), found.begin(), found.end());
+  }
+  return global.value.get();
+}
+
+std::pair<std::string_view, const Value*> LazyTree::find(std::string_view key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::string path(key);
+  auto cached = paths.find(path);
+  if (cached != paths.end()) {
+    return {cached->first, cached->second};
+  }
+  auto dot = key.find('.');
+  auto global = lookup.find(key.substr(0, dot));
+  if (global == lookup.end()) {
+    return {key, nullptr};
+  }
+  const Value* value = build(globals[global->second]);
+  while (value && dot != std::string_view::npos) {
+    auto start = dot + 1;
+    dot = key.find('.', start);
+    auto segment = key.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start);
+    value = has_children(value) ? child_of(value, segment) : nullptr;
+  }
+  if (!value) {
+    return {key, nullptr};
+  }
+  return {paths.emplace(std::move(path), value).first->first, value};
+}
+
+const Result::RootType& LazyTree::complete() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!is_complete) {
+    for (auto& global : globals) {
+      if (build(global)) {
+        root.emplace(std::string(global.key), global.value);
+      }
+    }
+    is_complete = true;
+  }
+  return root;
+}
+
+bool LazyTree::has_errors() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !errors.empty();
+}
+
+std::vector<Error> LazyTree::get_errors() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return errors;
+}
+
+const std::vector<Error>& LazyTree::get_complete_errors() {
+  complete();
+  return errors;
+}
+
+void LazyTree::attach(Result& result, std::shared_ptr<LazyTree> lazy) {
+  result.lazy = std::move(lazy);
+}
+
+/**
+ * The result owns a reference to the schema, the values only point to its
+ * types (see Value). Taking `schema` by value lets batch parsing make those
+ * references up front, so workers never touch the schema's reference counts.
+ */
+Result parse(std::shared_ptr<const ObjectType> schema, std::shared_ptr<const Buffer> buffer, const Options& options) {
+  std::vector<Error> errors;
+  Result::RootType values;
+  auto config = buffer->view();
+  Lexer lexer(config, errors);
+  std::shared_ptr<Arena> arena;
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+  if (options.use_arena) {
+    arena = Arena::create(config.size() * 2);
+    resource = arena->resource();
+  }
+#ifdef CONFY_USE_STATS
+  auto start = Probe::Clock::now();
+  auto probe = std::make_shared<Probe>(resource, options.hooks);
+  lexer.probe = probe.get();
+  resource = probe.get();
+#endif
+  TreeBuilder builder(lexer, resource, options.max_depth);
+  std::shared_ptr<LazyTree> lazy;
+  if (options.lazy) {
+    lazy = std::make_shared<LazyTree>(config, resource, options.max_depth);
+    CONFY_STATS(lazy->probe = probe.get();)
+    while (!index_global(schema.get(), lexer, *lazy, builder)) {}
+    lazy->errors.swap(errors);
+  } else {
+    while (true) {
+      if (parse_global(schema.get(), lexer, values, builder)) {
+        break;
+      }
+    }
+  }
+  auto result = Result::create(std::move(values), std::move(buffer), std::move(errors), std::move(arena), std::move(schema));
+  if (lazy) {
+    LazyTree::attach(result, std::move(lazy));
+  }
+#ifdef CONFY_USE_STATS
+  probe->stats.bytes = lexer.char_index;
+  probe->stats.parse_time = std::chrono::duration_cast<Stats::Duration>(Probe::Clock::now() - start) - probe->stats.validate_time;
+  Probe::attach(result, std::move(probe));
+#endif
+  return result;
+}
+
+Result parse(Interface& root, std::shared_ptr<const Buffer> buffer, const Options& options) {
+  return parse(root.get_globals(), std::move(buffer), options);
+}
+
+} // namespace _internal
+
+StreamParser::StreamParser(Interface& root, Handler& handler) : root(root.get_globals()), handler(handler) {
+  stack.push_back({this->root.get(), nullptr, std::vector<bool>(this->root->size()), true, std::nullopt});
+}
+
+bool StreamParser::has_errors() const {
+  return !errors.empty();
+}
+
+const std::vector<Error>& StreamParser::get_errors() const {
+  return errors;
+}
+
+bool StreamParser::feed(std::string_view chunk) {
+  if (has_errors()) {
+    return false;
+  }
+  if (pending.empty()) {
+    // Only copy what is left of the chunk once we run out of complete tokens.
+    return process(chunk, false);
+  }
+  pending.append(chunk);
+  auto input = std::move(pending);
+  pending.clear();
+  return process(input, false);
+}
+
+bool StreamParser::finish() {
+  if (has_errors()) {
+    return false;
+  }
+  auto input = std::move(pending);
+  pending.clear();
+  return process(input, true);
+}
+
+bool StreamParser::process(std::string_view input, bool final) {
+  size_t index = 0;
+  while (state != State::Done) {
+    auto token = next_token(input, index, final);
+    if (!token) {
+      if (has_errors()) {
+        return false;
+      }
+      pending.assign(input.substr(index));
+      return true;
     }
-    return String::create(val_type, value);
-  } else if (std::isdigit(config[char_index])) {
-    std::string value;
-    while (std::isdigit(config[char_index]) || config[char_index] == '.') {
-      value += config[char_index];
-      pos.column++;
-      char_index++;
+    if (!step(*token)) {
+      return false;
     }
-    if (!val_type->is<NumType>()) {
-      create_error("Expected '" + val_type->name() + "' and got 'number'", pos, errors);
-      return std::nullopt;
+  }
+  return true;
+}
+
+std::optional<StreamParser::Token> StreamParser::next_token(std::string_view input, size_t& index, bool final) {
+  using namespace parser_internal;
+  // Work on a copy of the position, only kept once a whole token was read.
+  auto at = pos;
+  size_t i = index;
+  while (true) {
+    auto end = scan::skip<scan::Blank>(input, i);
+    at.column += static_cast<int>(end - i);
+    i = end;
+    if (i < input.size() && input[i] == '#') {
+      end = scan::find_char(input, i, '\n');
+      if (end == input.size() && !final) {
+        // Wait for the end of the comment.
+        index = i;
+        pos = at;
+        return std::nullopt;
+      }
+      at.column += static_cast<int>(end - i);
+      i = end;
+      continue;
     }
-    EXPECT_END_OF_VALUE();
-    auto num = std::stod(value);
-    if (auto err = utils::as<NumType>(val_type)->validate(num)) {
-      create_error(err.value(), pos, errors);
-      return std::nullopt;
+    break;
+  }
+  // Blanks and comments are consumed even if no token follows yet.
+  index = i;
+  pos = at;
+  if (i >= input.size()) {
+    if (final) {
+      return Token {Token::Kind::End, {}, at};
     }
-    return Number::create(val_type, num);
-  } else if (config[char_index] == '{') {
-    PARSER_NEXT_CHAR();
-    if (config[char_index] != '\n') {
-      create_error("Expected '<newline>' and got '" + std::string(1, config[char_index]) + "'", pos, errors);
-      return std::nullopt;
+    return std::nullopt;
+  }
+  char c = input[i];
+  Token token {Token::Kind::Symbol, input.substr(i, 1), at};
+  if (c == '\n') {
+    token.kind = Token::Kind::Newline;
+    at.line++;
+    at.column = 1;
+    i++;
+  } else if (c == '"' && (state == State::Value || state == State::ArrayFirst)) {
+    // Elsewhere a quote is unexpected, and reported without reading a string.
+    size_t start = ++i;
+    at.column++;
+    while (true) {
+      auto end = scan::find<scan::QuoteOrNewline>(input, i);
+      at.column += static_cast<int>(end - i);
+      i = end;
+      if (i >= input.size()) {
+        if (final) {
+          fail("Unexpected end of file", at);
+        }
+        return std::nullopt;
+      }
+      if (input[i] == '"') {
+        break;
+      }
+      at.line++;
+      at.column = 1;
+      i++;
     }
-    SKIP_WHITESPACE(false)
-    std::unordered_map<std::string, std::shared_ptr<Value>> rvalues;
-    if (!val_type->is<ObjectType>()) {
-      create_error("Expected '" + val_type->name() + "' and got 'object'", pos, errors);
+    token.kind = Token::Kind::String;
+    token.text = input.substr(start, i - start);
+    at.column++;
+    i++;
+  } else if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+    bool number = c >= '0' && c <= '9';
+    size_t start = i;
+    i = number ? scan::skip<scan::NumberChar>(input, i) : scan::skip<scan::IdentifierChar>(input, i);
+    if (i >= input.size() && !final) {
+      // The token might go on in the next chunk.
       return std::nullopt;
     }
-    while (config[char_index] != '}') {
-      SKIP_WHITESPACE(false);
-      if (config[char_index] == '}') {
-        break;
-      }
-      auto identifier = get_identifier(config, char_index, pos);
-      if (!identifier) {
-        create_error("Expected identifier and got '" + std::string(1, config[char_index]) + "'", pos, errors);
+    token.kind = number ? Token::Kind::Number : Token::Kind::Identifier;
+    token.text = input.substr(start, i - start);
+    at.column += static_cast<int>(i - start);
+  } else {
+    if (c == '{') {
+      if (i + 1 >= input.size() && !final) {
+        // Wait for the character following the brace.
         return std::nullopt;
       }
-      SKIP_WHITESPACE(false);
-      // TODO: set the new root here!
-      auto val = parse_value(utils::as<ObjectType>(val_type), config, values, errors, pos, char_index, identifier, false);
-      if (!val) {
-        return std::nullopt;
+      token.next = i + 1 < input.size() ? input[i + 1] : '\0';
+    }
+    at.column++;
+    i++;
+  }
+  index = i;
+  pos = at;
+  return token;
+}
+
+bool StreamParser::fail(const std::string& message, const Error::Position& at) {
+  errors.push_back(Error(message, at));
+  handler.on_error(errors.back());
+  state = State::Done;
+  return false;
+}
+
+// The character the token starts with, as the eager parser describes it.
+std::string StreamParser::describe(const Token& token) {
+  if (token.kind == Token::Kind::String) {
+    return "\"";
+  }
+  return token.text.empty() ? std::string(1, '\0') : std::string(1, token.text[0]);
+}
+
+// Type mismatches are reported past the value, where `pos` is.
+bool StreamParser::begin_value(const Token& token) {
+  if (token.kind == Token::Kind::String) {
+    if (!expected->is<StringType>()) {
+      return fail("Expected '" + expected->name() + "' and got '" + std::string(token.text) + "'", pos);
+    }
+    auto err = utils::as<const StringType>(expected)->validate(std::string(token.text));
+    if (!err && emit_value) {
+      handler.on_string(token.text);
+    }
+    return end_value(std::move(err));
+  }
+  if (token.kind == Token::Kind::Number) {
+    auto number = parser_internal::to_number(token.text);
+    if (!number) {
+      return fail("Invalid number '" + std::string(token.text) + "'", token.pos);
+    }
+    if (!expected->is<NumType>()) {
+      return fail("Expected '" + expected->name() + "' and got 'number'", pos);
+    }
+    auto err = utils::as<const NumType>(expected)->validate(*number);
+    if (!err && emit_value) {
+      handler.on_number(*number);
+    }
+    return end_value(std::move(err));
+  }
+  if (token.kind == Token::Kind::Symbol && token.text == "{") {
+    if (token.next != '\n') {
+      return fail("Expected '<newline>' and got '" + std::string(1, token.next) + "'", pos);
+    }
+    if (!expected->is<ObjectType>()) {
+      return fail("Expected '" + expected->name() + "' and got 'object'", pos);
+    }
+    state = State::ObjectNewline;
+    return true;
+  }
+  if (token.kind == Token::Kind::Symbol && token.text == "[") {
+    if (!expected->is<ArrayType>()) {
+      return fail("Expected '" + expected->name() + "' and got 'array'", pos);
+    }
+    if (emit_value) {
+      handler.on_begin_array();
+    }
+    auto element = utils::as<const ArrayType>(expected)->get().get();
+    stack.push_back({nullptr, element, {}, emit_value, std::nullopt});
+    state = State::ArrayFirst;
+    comma_end.reset();
+    return true;
+  }
+  return fail("Expected a valid value but found '" + describe(token) + "'", token.pos);
+}
+
+/**
+ * Decides what follows a complete value: more elements, or the end of the
+ * line. A validator's error is kept until then, for the array or the end of
+ * the line.
+ */
+bool StreamParser::end_value(std::optional<std::string> err) {
+  auto& frame = stack.back();
+  if (frame.object) {
+    invalid = std::move(err);
+    state = State::EndOfValue;
+  } else {
+    if (err && !frame.invalid) {
+      frame.invalid = Error(*err, pos);
+    }
+    state = State::ArrayNext;
+  }
+  return true;
+}
+
+bool StreamParser::step(const Token& token) {
+  auto is = [&](const char* symbol) {
+    return token.kind == Token::Kind::Symbol && token.text == symbol;
+  };
+  switch (state) {
+    case State::Entry: {
+      auto& frame = stack.back();
+      if (token.kind == Token::Kind::Newline) {
+        return true;
       }
-      if (rvalues.find(*identifier) != rvalues.end()) {
-        create_error("Duplicate identifier '" + *identifier + "'", pos, errors);
-        return std::nullopt;
+      if (token.kind == Token::Kind::End && stack.size() == 1) {
+        state = State::Done;
+        return true;
+      }
+      if (is("}") && stack.size() > 1) {
+        bool emit = frame.emit;
+        stack.pop_back();
+        if (emit) {
+          handler.on_exit_object();
+        }
+        return end_value(std::nullopt);
       }
-      rvalues[*identifier] = *val;
+      if (token.kind != Token::Kind::Identifier) {
+        return fail("Expected identifier and got '" + describe(token) + "'", token.pos);
+      }
+      auto slot = frame.object->slot(token.text);
+      if (slot == frame.object->size() || frame.seen[slot]) {
+        auto problem = slot == frame.object->size() ? "Unknown identifier '" : "Duplicate identifier '";
+        auto message = problem + std::string(token.text) + "'";
+        if (stack.size() == 1) {
+          return fail(message, token.pos);
+        }
+        // Nested keys are reported at whatever follows them.
+        key_error = std::move(message);
+        state = State::Assign;
+        return true;
+      }
+      frame.seen[slot] = true;
+      expected = frame.object->at(slot).second.get();
+      emit_value = frame.emit && handler.on_key(token.text, *expected);
+      top_level_object = stack.size() == 1;
+      state = State::Assign;
+      return true;
     }
-    PARSER_NEXT_CHAR();
-    EXPECT_END_OF_VALUE();
-    return Object::create(val_type, rvalues);
-  } else if (config[char_index] == '[') {
-    PARSER_NEXT_CHAR();
-    std::vector<std::shared_ptr<Value>> rvalues;
-    if (!val_type->is<ArrayType>()) { // TODO: Check for array subtypes
-      create_error("Expected '" + val_type->name() + "' and got 'array'", pos, errors);
-      return std::nullopt;
+    case State::Assign:
+      if (key_error) {
+        return fail(*key_error, token.pos);
+      }
+      if (is("=")) {
+        state = State::Value;
+        return true;
+      }
+      // Top level objects can be declared either as `name = {` or as `name {`.
+      if (is("{") && top_level_object) {
+        return begin_value(token);
+      }
+      return fail("Expected '=' and got '" + describe(token) + "'", token.pos);
+    case State::Value:
+      return begin_value(token);
+    case State::ObjectNewline: {
+      if (token.kind != Token::Kind::Newline) {
+        return fail("Expected '<newline>' and got '" + describe(token) + "'", token.pos);
+      }
+      auto object = utils::as<const ObjectType>(expected);
+      if (emit_value) {
+        handler.on_enter_object();
+      }
+      stack.push_back({object, nullptr, std::vector<bool>(object->size()), emit_value, std::nullopt});
+      state = State::Entry;
+      return true;
     }
-    auto as_array = utils::as<ArrayType>(val_type);
-    while (config[char_index] != ']') {
-      auto temp_root = std::make_shared<ObjectType>(std::vector<ObjectType::TypePair> {
-        {"$temp", as_array->get()}
-      });
-      auto val = parse_value(temp_root, config, values, errors, pos, char_index, "$temp", true, false);
-      if (!val) {
-        return std::nullopt;
+    case State::ArrayFirst:
+    case State::ArrayNext: {
+      auto& frame = stack.back();
+      // Trailing commas are allowed, as in `[1, 2,]`, but not followed by blanks.
+      bool trailing = comma_end && comma_end->line == token.pos.line && comma_end->column == token.pos.column;
+      if (is("]") && (state == State::ArrayNext || !comma_end || trailing)) {
+        if (frame.invalid) {
+          return fail(frame.invalid->get_message(), frame.invalid->get_position());
+        }
+        bool emit = frame.emit;
+        stack.pop_back();
+        if (emit) {
+          handler.on_end_array();
+        }
+        comma_end.reset();
+        return end_value(std::nullopt);
       }
-      rvalues.push_back(*val);
-      if (config[char_index] == ',') {
-        PARSER_NEXT_CHAR();
-        continue;
+      if (state == State::ArrayNext) {
+        if (!is(",")) {
+          return fail("Expected ',' or ']' and got '" + describe(token) + "'", token.pos);
+        }
+        state = State::ArrayFirst;
+        comma_end = pos;
+        return true;
       }
-      if (config[char_index] == ']') {
-        break;
+      expected = frame.element;
+      emit_value = frame.emit;
+      return begin_value(token);
+    }
+    case State::EndOfValue: {
+      if (token.kind != Token::Kind::Newline && token.kind != Token::Kind::End) {
+        return fail("Expected '<newline>' and got '" + describe(token) + "'", token.pos);
+      }
+      // Past the newline (or the end of the file, which also ends a value).
+      Error::Position next_line {token.pos.line + 1, 1};
+      if (invalid) {
+        return fail(*invalid, next_line);
+      }
+      if (token.kind == Token::Kind::End) {
+        if (stack.size() > 1) {
+          return fail("Expected identifier and got '" + describe(token) + "'", next_line);
+        }
+        state = State::Done;
       } else {
-        create_error("Expected ',' or ']' and got '" + std::string(1, config[char_index]) + "'", pos, errors);
-        return std::nullopt;
+        state = State::Entry;
       }
+      return true;
     }
-    PARSER_NEXT_CHAR();
-    EXPECT_END_OF_VALUE();
-    return Array::create(val_type, rvalues);
+    case State::Done:
+      return true;
   }
-  create_error("Expected a valid value but found '" + std::string(1, config[char_index]) + "'", pos, errors);
-  return std::nullopt;
+  return true;
 }
 
-bool parse_global_rule(std::shared_ptr<ObjectType> root, const std::string& config, 
-  Result::RootType& values, 
-  std::vector<Error>& errors, Error::Position& pos, 
-  size_t& char_index, bool is_global = false) {
-  Error::Position copy_pos = pos;
-  auto identifier = get_identifier(config, char_index, pos);
-  if (!identifier) {
-    return create_error("Expected identifier and got '" + std::string(1, config[char_index]) + "'", pos, errors);
+Result parse(Interface& root, const std::string& config, const Options& options) {
+  return parser_internal::parse(root, Buffer::own(config), options);
+}
+
+Result parse(Interface& root, std::string&& config, const Options& options) {
+  return parser_internal::parse(root, Buffer::own(std::move(config)), options);
+}
+
+Result parse(Interface& root, const char* config, const Options& options) {
+  return parser_internal::parse(root, Buffer::own(config), options);
+}
+
+Result parse(Interface& root, std::string_view config, const Options& options) {
+  return parser_internal::parse(root, Buffer::borrow(config), options);
+}
+
+namespace merge_internal {
+
+// Whether a result holds values of the given schema (results without values always do).
+static bool parsed_with(const Type* schema, const Type* globals, bool empty) {
+  if (!schema) {
+    return empty;
   }
+  return schema == globals || schema->fingerprint() == globals->fingerprint();
+}
 
-  if (!root->has(*identifier)) {
-    return create_error("Unknown identifier '" + *identifier + "'", copy_pos, errors);
+/**
+ * Objects present on both sides are merged into a new object sharing their
+ * entries, anything else is taken from the overlay. Both sides were parsed
+ * with the same interface, so their entries line up slot by slot.
+ */
+static std::shared_ptr<Value> overlay(const std::shared_ptr<Value>& base, const std::shared_ptr<Value>& top) {
+  if (!base->is_object() || !top->is_object()) {
+    return top;
+  }
+  const auto& top_slots = static_cast<const Object&>(*top).get_slots();
+  Object::Slots entries = static_cast<const Object&>(*base).get_slots();
+  for (size_t slot = 0; slot < entries.size(); slot++) {
+    if (!top_slots[slot]) {
+      continue;
+    }
+    entries[slot] = entries[slot] ? overlay(entries[slot], top_slots[slot]) : top_slots[slot];
   }
+  return std::make_shared<Object>(base->get_type_ref(), std::move(entries));
+}
+
+} // namespace merge_internal
 
-  SKIP_WHITESPACE(false);
-  if (is_global && config[char_index] != '{') {
-    auto val = parse_value(root, config, values, errors, pos, char_index, identifier, false);
-    if (!val) {
-      return EXIT_FAILURE;
+Result merge(Interface& root, const Result& base, const Result& overlay) {
+  auto globals = root.get_globals();
+  const auto& base_root = base.get_root_ref();
+  const auto& overlay_root = overlay.get_root_ref();
+  if (!merge_internal::parsed_with(base.schema.get(), globals.get(), base_root.empty())
+    || !merge_internal::parsed_with(overlay.schema.get(), globals.get(), overlay_root.empty())) {
+    return Result::create({}, "", {Error("Can not merge results parsed with another interface", Error::Position {1, 1})});
+  }
+  std::vector<Error> errors = base.get_errors_ref();
+  errors.insert(errors.end(), overlay.get_errors_ref().begin(), overlay.get_errors_ref().end());
+  auto result = Result::create(base_root, Buffer::own(""), std::move(errors), nullptr, std::move(globals));
+  auto& layers = result.layers;
+  // Results merged before carry the layers of their own inputs.
+  for (const auto* input : {&base, &overlay}) {
+    layers.insert(layers.end(), input->layers.begin(), input->layers.end());
+    // The values point to the types of the input's schema, and the keys of its objects are theirs.
+    for (std::shared_ptr<const void> owner : {std::shared_ptr<const void>(input->schema),
+      std::shared_ptr<const void>(input->arena), std::shared_ptr<const void>(input->buffer)}) {
+      if (owner) {
+        layers.push_back(std::move(owner));
+      }
+    }
+#ifdef CONFY_USE_STATS
+    if (input->probe) {
+      layers.push_back(input->probe);
+    }
+#endif
+  }
+  for (const auto& [key, value] : overlay_root) {
+    auto it = result.root.find(key);
+    if (it == result.root.end()) {
+      result.root.emplace(key, value);
+    } else {
+      it->second = merge_internal::overlay(it->second, value);
     }
-    values.insert(std::make_pair(*identifier, *val));
-    return EXIT_SUCCESS;
   }
+  return result;
+}
+
+#if defined(CONFY_USE_FILE) && CONFY_USE_FILE
+namespace parser_internal {
+// Mapping is opt-in, as a mapped result changes (or crashes) with its file.
+std::shared_ptr<Buffer> open_file(const std::string& file, const Options& options) {
+  return options.map_file ? Buffer::map(file) : Buffer::read(file);
+}
+} // namespace parser_internal
 
-  if (!is_global) {
+Result parse_file(Interface& root, const std::string& file, const Options& options) {
+  CONFY_STATS(auto start = parser_internal::Probe::Clock::now();)
+  auto buffer = parser_internal::open_file(file, options);
+  if (!buffer) {
+    return Result::create({}, "", {Error("Could not open file", Error::Position {1, 1})});
   }
+  CONFY_STATS(auto read_time = parser_internal::Probe::Clock::now() - start;)
+  auto result = parser_internal::parse(root, std::move(buffer), options);
+  CONFY_STATS(parser_internal::Probe::set_read_time(result, read_time);)
+  return result;
+}
 
-  PARSER_EXPECT_CHAR('{');
-  char_index--; // We need to reparse the '{' character
+namespace parser_internal {
 
-  // It's the same syntax as the global rule
-  auto val = parse_value(root, config, values, errors, pos, char_index, identifier, false, false);
-  if (!val) {
-    return EXIT_FAILURE;
+/**
+ * Runs task(i) for every i in [0, count) on up to `threads` threads, the
+ * calling one included. Each worker starts with a contiguous share of the
+ * indices and pops them from the front, once it runs out it steals the back
+ * half of another worker's share. Shares are packed as [begin, end) in one
+ * atomic word, so popping and stealing are a single compare-and-swap.
+ */
+template <typename Task>
+void run_stealing(size_t count, size_t threads, const Task& task) {
+  struct alignas(64) Share {
+    std::atomic<uint64_t> range {0};
+  };
+  auto pack = [](uint64_t begin, uint64_t end) { return (begin << 32) | end; };
+  std::vector<Share> shares(threads);
+  for (size_t i = 0; i < threads; i++) {
+    shares[i].range = pack(count * i / threads, count * (i + 1) / threads);
+  }
+  auto work = [&](size_t self) {
+    auto& own = shares[self].range;
+    while (true) {
+      auto range = own.load(std::memory_order_acquire);
+      uint64_t begin = range >> 32, end = range & 0xffffffff;
+      if (begin < end) {
+        if (own.compare_exchange_weak(range, pack(begin + 1, end), std::memory_order_acq_rel)) {
+          task(static_cast<size_t>(begin));
+        }
+        continue;
+      }
+      bool stole = false;
+      for (size_t i = 1; i < threads && !stole; i++) {
+        auto& other = shares[(self + i) % threads].range;
+        auto victim = other.load(std::memory_order_acquire);
+        while (true) {
+          uint64_t from = victim >> 32, to = victim & 0xffffffff;
+          if (from >= to) {
+            break;
+          }
+          auto middle = to - (to - from) / 2;
+          if (other.compare_exchange_weak(victim, pack(from, middle), std::memory_order_acq_rel)) {
+            // Nobody touches an empty share, so it can be refilled with a plain store.
+            own.store(pack(middle, to), std::memory_order_release);
+            stole = true;
+            break;
+          }
+        }
+      }
+      if (!stole) {
+        return;
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(work, i);
+  }
+  work(0);
+  for (auto& worker : workers) {
+    worker.join();
   }
-  values.insert(std::make_pair(*identifier, *val));
-  PARSER_NEXT_CHAR();
-  return EXIT_SUCCESS;
 }
 
-bool parse_global(Interface& root, const std::string& config, 
-  Result::RootType& values, 
-  std::vector<Error>& errors, Error::Position& pos, 
-  size_t& char_index) {
+} // namespace parser_internal
 
-  while (char_index < config.size()) {
-    switch (config[char_index]) {
-      case ' ':
-      case '\t':
-        char_index++;
-        pos.column++;
-        break;
+std::vector<Result> parse_files(Interface& root, const std::vector<std::string>& files, const Options& options, size_t threads) {
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  threads = std::max<size_t>(1, std::min(threads, files.size()));
+  // Every result owns a reference to the schema, take them all here so the
+  // workers do not contend on its reference count.
+  std::vector<std::shared_ptr<const ObjectType>> schemas(files.size(), root.get_globals());
+  std::vector<std::optional<Result>> parsed(files.size());
+  parser_internal::run_stealing(files.size(), threads, [&](size_t i) {
+    CONFY_STATS(auto start = parser_internal::Probe::Clock::now();)
+    auto buffer = parser_internal::open_file(files[i], options);
+    if (!buffer) {
+      parsed[i].emplace(Result::create({}, "", {Error("Could not open file", Error::Position {1, 1})}));
+      return;
+    }
+    CONFY_STATS(auto read_time = parser_internal::Probe::Clock::now() - start;)
+    parsed[i].emplace(parser_internal::parse(std::move(schemas[i]), std::move(buffer), options));
+    CONFY_STATS(parser_internal::Probe::set_read_time(*parsed[i], read_time);)
+  });
+  std::vector<Result> results;
+  results.reserve(files.size());
+  for (auto& result : parsed) {
+    results.push_back(std::move(*result));
+  }
+  return results;
+}
+
+namespace cache_internal {
+
+/**
+ * Cache layout: a Header, then `node_count` Nodes, then the strings. The
+ * strings start with a copy of the source, which the result's buffer points
+ * into, followed by the strings that were not found in it.
+ *
+ * Children of an object or an array are stored next to each other, and the
+ * top-level entries are the first `root_count` nodes.
+ */
+struct Header {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t node_size;
+  uint64_t content_hash;
+  uint64_t schema_hash;
+  uint64_t node_count;
+  uint64_t root_count;
+  uint64_t source_size;
+  uint64_t strings_size;
+  // Hash of everything following the header, to reject corrupted caches.
+  uint64_t body_hash;
+};
+
+struct Node {
+  uint32_t kind;
+  uint32_t key_size;
+  uint64_t key_offset;
+  // Strings: offset and size. Numbers: the bits of the value. Objects and
+  // arrays: index of the first child and number of children.
+  uint64_t first;
+  uint64_t second;
+};
+
+constexpr char magic[8] = {'c', 'o', 'n', 'f', 'y', 0, 0, 1};
+constexpr uint32_t byte_order = 0x01020304;
+
+// 64-bit FNV-1a, `seed` chains hashes of consecutive parts.
+uint64_t hash(std::string_view data, uint64_t seed = 0xcbf29ce484222325ull) {
+  uint64_t result = seed;
+  for (unsigned char c : data) {
+    result = (result ^ c) * 0x100000001b3ull;
+  }
+  return result;
+}
+
+uint64_t schema_hash(Interface& root) {
+  return hash(root.get_globals()->fingerprint());
+}
+
+class Writer {
+public:
+  Writer(std::string_view source) : source(source) {
+    strings.assign(source.data(), source.size());
+  }
+
+  // Reserves the nodes of a list of entries before filling them, so siblings stay contiguous.
+  template <typename Entries>
+  uint64_t write_entries(const Entries& entries) {
+    auto first = nodes.size();
+    nodes.resize(first + entries.size());
+    size_t i = first;
+    for (const auto& [key, value] : entries) {
+      write(i++, key, value.get());
+    }
+    return first;
+  }
 
-      case '\n':
-        pos.column = 1;
-        pos.line++;
-        char_index++;
+  void write(size_t at, std::string_view key, const Value* value) {
+    Node node {static_cast<uint32_t>(value->get_kind()), static_cast<uint32_t>(key.size()), add(key), 0, 0};
+    switch (value->get_kind()) {
+      case Kind::String: {
+        auto view = static_cast<const String*>(value)->get_view();
+        node.first = add(view);
+        node.second = view.size();
+        break;
+      }
+      case Kind::Number: {
+        double number = static_cast<const Number*>(value)->get_value();
+        std::memcpy(&node.first, &number, sizeof(number));
+        break;
+      }
+      case Kind::Object: {
+        auto object = static_cast<const Object*>(value);
+        node.first = write_entries(*object);
+        node.second = object->size();
+        break;
+      }
+      case Kind::Array: {
+        auto array = static_cast<const Array*>(value);
+        node.first = nodes.size();
+        node.second = array->size();
+        nodes.resize(nodes.size() + array->size());
+        auto element = utils::as<const ArrayType>(array->get_type_ref())->get().get();
+        auto numbers = array->get_numbers();
+        for (size_t i = 0; i < array->size(); i++) {
+          // Contiguous arrays are written without creating their elements.
+          if (!numbers.empty()) {
+            Node number {static_cast<uint32_t>(Kind::Number), 0, 0, 0, 0};
+            std::memcpy(&number.first, &numbers[i], sizeof(double));
+            nodes[node.first + i] = number;
+          } else if (element->is<StringType>()) {
+            auto view = array->get_string_view(i);
+            nodes[node.first + i] = Node {static_cast<uint32_t>(Kind::String), 0, 0, add(view), view.size()};
+          } else {
+            write(node.first + i, {}, array->get_elements()[i].get());
+          }
+        }
         break;
+      }
+      default:
+        break;
+    }
+    nodes[at] = node;
+  }
 
-      case 0:
-        return EXIT_FAILURE;
+  std::string_view source;
+  std::vector<Node> nodes;
+  std::string strings;
+private:
+  // Strings pointing into the source are stored as offsets into its copy,
+  // others (such as object keys, which point into the schema) once each.
+  uint64_t add(std::string_view text) {
+    auto begin = reinterpret_cast<uintptr_t>(source.data());
+    auto at = reinterpret_cast<uintptr_t>(text.data());
+    if (!text.empty() && at >= begin && at + text.size() <= begin + source.size()) {
+      return at - begin;
+    }
+    // The views point into the result being written, which outlives the writer.
+    auto [it, added] = interned.emplace(text, strings.size());
+    if (added) {
+      strings.append(text);
+    }
+    return it->second;
+  }
 
-      default: {
-        return parse_global_rule(root.get_globals(), config, values, errors, pos, char_index, true);
+  std::unordered_map<std::string_view, uint64_t> interned;
+};
+
+class Reader {
+public:
+  Reader(const Header& header, const char* nodes, std::string_view strings, std::pmr::memory_resource* resource)
+    : header(header), nodes(nodes), strings(strings), resource(resource) {}
+
+  // Returns nullptr if the cache does not match the schema or is corrupted.
+  std::shared_ptr<Value> read(uint64_t at, const Type* type) const {
+    using parser_internal::make_value;
+    auto node = get(at);
+    switch (static_cast<Kind>(node.kind)) {
+      case Kind::String:
+        if (!type->is<StringType>() || node.first + node.second > strings.size()) {
+          return nullptr;
+        }
+        return make_value<String>(resource, type, strings.substr(node.first, node.second), true);
+      case Kind::Number: {
+        if (!type->is<NumType>()) {
+          return nullptr;
+        }
+        double number;
+        std::memcpy(&number, &node.first, sizeof(number));
+        return make_value<Number>(resource, type, number);
+      }
+      case Kind::Object: {
+        if (!type->is<ObjectType>() || !in_range(at, node)) {
+          return nullptr;
+        }
+        auto object_type = utils::as<const ObjectType>(type);
+        Object::Slots values(object_type->size(), resource);
+        for (uint64_t i = node.first; i < node.first + node.second; i++) {
+          auto slot = object_type->slot(key_of(get(i)));
+          if (slot == values.size() || values[slot]) {
+            return nullptr;
+          }
+          values[slot] = read(i, object_type->at(slot).second.get());
+          if (!values[slot]) {
+            return nullptr;
+          }
+        }
+        return make_value<Object>(resource, type, std::move(values));
       }
+      case Kind::Array: {
+        if (!type->is<ArrayType>() || !in_range(at, node)) {
+          return nullptr;
+        }
+        auto element = utils::as<const ArrayType>(type)->get().get();
+        if (element->is<NumType>() || (element->is<StringType>() && strings.size() <= UINT32_MAX)) {
+          return read_contiguous(node, type, element);
+        }
+        Array::Values values(resource);
+        values.reserve(node.second);
+        for (uint64_t i = node.first; i < node.first + node.second; i++) {
+          auto value = read(i, element);
+          if (!value) {
+            return nullptr;
+          }
+          values.push_back(std::move(value));
+        }
+        return make_value<Array>(resource, type, std::move(values));
+      }
+      default:
+        return nullptr;
     }
   }
-  return EXIT_FAILURE; // End the loop
-}
 
-} // namespace _internal
+  // Arrays of numbers and strings are rebuilt into contiguous storage, as the parser does.
+  std::shared_ptr<Value> read_contiguous(const Node& array, const Type* type, const Type* element) const {
+    using parser_internal::make_value;
+    bool is_number = element->is<NumType>();
+    Array::Numbers numbers(resource);
+    Array::Strings slices(resource);
+    for (uint64_t i = array.first; i < array.first + array.second; i++) {
+      auto node = get(i);
+      if (is_number && static_cast<Kind>(node.kind) == Kind::Number) {
+        double number;
+        std::memcpy(&number, &node.first, sizeof(number));
+        numbers.push_back(number);
+      } else if (!is_number && static_cast<Kind>(node.kind) == Kind::String && node.first + node.second <= strings.size()) {
+        slices.push_back({static_cast<uint32_t>(node.first), static_cast<uint32_t>(node.second)});
+      } else {
+        return nullptr;
+      }
+    }
+    if (is_number) {
+      return make_value<Array>(resource, type, std::move(numbers));
+    }
+    return make_value<Array>(resource, type, strings.data(), std::move(slices));
+  }
 
-Result parse(Interface& root, const std::string& config) {
-  std::vector<Error> errors;
+  Node get(uint64_t at) const {
+    Node node;
+    std::memcpy(&node, nodes + at * sizeof(Node), sizeof(Node));
+    return node;
+  }
+
+  std::string_view key_of(const Node& node) const {
+    if (node.key_offset + node.key_size > strings.size()) {
+      return {};
+    }
+    return strings.substr(node.key_offset, node.key_size);
+  }
+private:
+  // Children always follow their parent, which also rules out cycles.
+  bool in_range(uint64_t at, const Node& node) const {
+    return node.first > at && node.first <= header.node_count && node.second <= header.node_count - node.first;
+  }
+
+  const Header& header;
+  const char* nodes;
+  std::string_view strings;
+  std::pmr::memory_resource* resource;
+};
+
+std::optional<Result> load(Interface& root, const std::string& cache, uint64_t content_hash, const Options& options) {
+  auto contents = parser_internal::open_file(cache, options);
+  if (!contents) {
+    return std::nullopt;
+  }
+  auto data = contents->view();
+  Header header;
+  if (data.size() < sizeof(Header)) {
+    return std::nullopt;
+  }
+  std::memcpy(&header, data.data(), sizeof(Header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.byte_order != byte_order
+    || header.node_size != sizeof(Node) || header.content_hash != content_hash
+    || header.schema_hash != schema_hash(root) || header.root_count > header.node_count
+    || header.node_count > (data.size() - sizeof(Header)) / sizeof(Node)) {
+    return std::nullopt;
+  }
+  auto strings_at = sizeof(Header) + header.node_count * sizeof(Node);
+  if (header.strings_size > data.size() - strings_at || header.source_size > header.strings_size
+    || header.body_hash != hash(data.substr(sizeof(Header), strings_at + header.strings_size - sizeof(Header)))) {
+    return std::nullopt;
+  }
+  std::shared_ptr<Arena> arena;
+  auto resource = std::pmr::get_default_resource();
+  if (options.use_arena) {
+    arena = Arena::create(header.node_count * 2 * sizeof(Node));
+    resource = arena->resource();
+  }
+  auto globals = root.get_globals();
+  Reader reader(header, data.data() + sizeof(Header), data.substr(strings_at, header.strings_size), resource);
   Result::RootType values;
-  Error::Position pos = {1, 1};
-  size_t char_index = 0;
-  while (true) {
-    if (parser_internal::parse_global(root, config, values, errors, pos, char_index)) {
-      break;
+  for (uint64_t i = 0; i < header.root_count; i++) {
+    auto key = reader.key_of(reader.get(i));
+    auto entry = globals->find(key);
+    auto value = entry ? reader.read(i, entry->second.get()) : nullptr;
+    if (!value) {
+      return std::nullopt;
+    }
+    values.emplace(std::string(key), std::move(value));
+  }
+  // The result's buffer is the copy of the source, the rest of the cache stays alive with it.
+  auto buffer = Buffer::slice(contents, strings_at, header.source_size);
+  return Result::create(std::move(values), std::move(buffer), {}, std::move(arena), std::move(globals));
+}
+
+} // namespace cache_internal
+
+bool write_cache(const Result& result, Interface& root, std::string_view config, const std::string& cache) {
+  using namespace cache_internal;
+  Writer writer(config);
+  const auto& values = result.get_root_ref();
+  writer.write_entries(values);
+  Header header {};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.byte_order = byte_order;
+  header.node_size = sizeof(Node);
+  header.content_hash = hash(config);
+  header.schema_hash = schema_hash(root);
+  header.node_count = writer.nodes.size();
+  header.root_count = values.size();
+  header.source_size = config.size();
+  header.strings_size = writer.strings.size();
+  auto nodes = std::string_view(reinterpret_cast<const char*>(writer.nodes.data()), writer.nodes.size() * sizeof(Node));
+  header.body_hash = hash(writer.strings, hash(nodes));
+  // Write next to the cache and rename it, so readers never see a partial cache.
+  auto temporary = cache + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(nodes.data(), nodes.size());
+    out.write(writer.strings.data(), writer.strings.size());
+    if (!out) {
+      std::remove(temporary.c_str());
+      return false;
     }
   }
-  return Result::create(values, config, errors);
+  return std::rename(temporary.c_str(), cache.c_str()) == 0;
 }
 
-Result parse_file(Interface& root, const std::string& file) {
-  std::ifstream ifs(file);
-  if (!ifs.is_open()) {
+Result parse_file_cached(Interface& root, const std::string& file, const std::string& cache, const Options& options) {
+  auto cache_file = cache.empty() ? file + ".cache" : cache;
+  CONFY_STATS(auto start = parser_internal::Probe::Clock::now();)
+  auto buffer = parser_internal::open_file(file, options);
+  if (!buffer) {
+    return Result::create({}, "", {Error("Could not open file", Error::Position {1, 1})});
+  }
+  CONFY_STATS(auto read_time = parser_internal::Probe::Clock::now() - start;)
+  auto content_hash = cache_internal::hash(buffer->view());
+  if (auto cached = cache_internal::load(root, cache_file, content_hash, options)) {
+    return std::move(*cached);
+  }
+  auto result = parser_internal::parse(root, buffer, options);
+  CONFY_STATS(parser_internal::Probe::set_read_time(result, read_time);)
+  // Lazy results are built entirely for the cache, which also finds their errors.
+  result.get_root_ref();
+  if (!result.has_errors()) {
+    write_cache(result, root, buffer->view(), cache_file);
+  }
+  return result;
+}
+#endif
+
+#if defined(CONFY_USE_RELOAD) && defined(CONFY_USE_FILE) && CONFY_USE_FILE
+// The file is read rather than mapped, as a mapping would change under the
+// published snapshots when the file is rewritten in place.
+static Result parse_copy(Interface& root, const std::string& file, const Options& options) {
+  CONFY_STATS(auto start = parser_internal::Probe::Clock::now();)
+  auto buffer = Buffer::read(file);
+  if (!buffer) {
     return Result::create({}, "", {Error("Could not open file", Error::Position {1, 1})});
   }
-  std::string config((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-  return parse(root, config);
+  CONFY_STATS(auto read_time = parser_internal::Probe::Clock::now() - start;)
+  auto result = parser_internal::parse(root, std::move(buffer), options);
+  CONFY_STATS(parser_internal::Probe::set_read_time(result, read_time);)
+  return result;
+}
+
+Reloader::Reader::Reader(const Reloader& reloader) : reloader(reloader) {}
+
+const Reloader::Snapshot& Reloader::Reader::snapshot() {
+  auto latest = reloader.get_version();
+  if (!cached || latest != version) {
+    // The snapshot is stored before the version is bumped, so it is at least
+    // as recent as `latest`.
+    cached = reloader.get();
+    version = latest;
+  }
+  return cached;
+}
+
+const Result& Reloader::Reader::get() {
+  return *snapshot();
+}
+
+Reloader::Reloader(Interface root, std::string file, Options options)
+  : root(std::move(root)), file(std::move(file)), options(options) {
+  // Watch before the first parse, so changes made while it runs are not missed.
+  auto path = std::filesystem::absolute(this->file);
+#if defined(__linux__)
+  // Not inherited by processes the application starts.
+  if (pipe2(stop_pipe, O_CLOEXEC) != 0) {
+    stop_pipe[0] = stop_pipe[1] = -1;
+  }
+  // Watch the directory rather than the file, editors often save by
+  // replacing the file which would drop a watch on the file itself.
+  notify_fd = inotify_init1(IN_CLOEXEC);
+  if (notify_fd != -1 && inotify_add_watch(notify_fd, path.parent_path().c_str(),
+      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+    close(notify_fd);
+    notify_fd = -1;
+  }
+#endif
+  std::error_code ec;
+  last_write = std::filesystem::last_write_time(path, ec);
+  auto first = std::make_shared<const Result>(parse_copy(this->root, this->file, options));
+  errors = first->get_errors();
+  publish(std::move(first));
+  watcher = std::thread([this] { watch(); });
+}
+
+Reloader::~Reloader() {
+  stop();
+#if defined(__linux__)
+  for (int fd : {stop_pipe[0], stop_pipe[1], notify_fd}) {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+Reloader::Snapshot Reloader::get() const {
+#if defined(__cpp_lib_atomic_shared_ptr) && __cpp_lib_atomic_shared_ptr >= 201711L
+  return current.load(std::memory_order_acquire);
+#else
+  return std::atomic_load_explicit(&current, std::memory_order_acquire);
+#endif
+}
+
+uint64_t Reloader::get_version() const {
+  return version.load(std::memory_order_acquire);
+}
+
+std::vector<Error> Reloader::get_errors() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return errors;
+}
+
+size_t Reloader::subscribe(Callback callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  subscribers.push_back({next_id, std::move(callback)});
+  return next_id++;
+}
+
+void Reloader::unsubscribe(size_t id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+    if (it->first == id) {
+      subscribers.erase(it);
+      return;
+    }
+  }
+}
+
+void Reloader::publish(Snapshot snapshot) {
+#if defined(__cpp_lib_atomic_shared_ptr) && __cpp_lib_atomic_shared_ptr >= 201711L
+  current.store(std::move(snapshot), std::memory_order_release);
+#else
+  std::atomic_store_explicit(&current, std::move(snapshot), std::memory_order_release);
+#endif
+  version.fetch_add(1, std::memory_order_release);
+}
+
+bool Reloader::reload() {
+  std::lock_guard<std::mutex> reloading(reload_mutex);
+  auto next = std::make_shared<const Result>(parse_copy(root, file, options));
+  auto previous = get();
+  decltype(subscribers) callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors = next->get_errors();
+    callbacks = subscribers;
+  }
+  if (next->has_errors() && !previous->has_errors()) {
+    return false;
+  }
+  auto changed = next->diff(*previous);
+  if (changed.empty() && next->has_errors() == previous->has_errors()) {
+    return false;
+  }
+  publish(next);
+  // Called without holding the lock, so callbacks may (un)subscribe.
+  if (!changed.empty()) {
+    for (const auto& [id, callback] : callbacks) {
+      callback(*next, changed);
+    }
+  }
+  return true;
+}
+
+void Reloader::stop() {
+  if (!running.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    wake.notify_all();
+  }
+#if defined(__linux__)
+  if (stop_pipe[1] != -1) {
+    char byte = 0;
+    (void) !write(stop_pipe[1], &byte, 1);
+  }
+#endif
+  if (watcher.joinable()) {
+    watcher.join();
+  }
 }
 
-#undef PARSER_NEXT_CHAR
-#undef PARSER_EXPECT_CHAR
+void Reloader::watch() {
+  namespace fs = std::filesystem;
+  auto path = fs::absolute(file);
+#if defined(__linux__)
+  if (notify_fd != -1 && stop_pipe[0] != -1) {
+    auto name = path.filename().string();
+    alignas(inotify_event) char events[4096];
+    while (running) {
+      pollfd fds[2] = {{notify_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+      if (poll(fds, 2, -1) <= 0 || (fds[1].revents & POLLIN)) {
+        continue;
+      }
+      bool touched = false;
+      auto length = read(notify_fd, events, sizeof(events));
+      for (ssize_t i = 0; i < length;) {
+        auto event = reinterpret_cast<const inotify_event*>(events + i);
+        if (event->len && name == event->name) {
+          touched = true;
+        }
+        i += sizeof(inotify_event) + event->len;
+      }
+      if (touched) {
+        reload();
+      }
+    }
+    return;
+  }
+#endif
+  // Fall back to polling the modification time.
+  std::error_code ec;
+  std::unique_lock<std::mutex> lock(wake_mutex);
+  while (running) {
+    wake.wait_for(lock, std::chrono::milliseconds(250));
+    auto time = fs::last_write_time(path, ec);
+    if (!ec && time != last_write) {
+      last_write = time;
+      reload();
+    }
+  }
+}
+#endif
 
 } // namespace confy
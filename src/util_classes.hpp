@@ -7,6 +7,512 @@
  *
  */
 
+namespace regex_internal {
+
+/**
+ * A deterministic automaton for the subset of ECMAScript regexes commonly used
+ * to validate configurations (versions, hostnames, identifiers...): literals,
+ * '.', classes, \d \w \s and their negations, groups, '|' and the '*', '+',
+ * '?' and '{n,m}' quantifiers. Matching is then one table lookup per character.
+ */
+class Dfa {
+public:
+  // Returns nullopt if the pattern is outside of the supported subset (or too large).
+  static std::optional<Dfa> compile(std::string_view pattern) {
+    Compiler compiler(pattern);
+    auto nfa = compiler.parse();
+    if (!nfa) {
+      return std::nullopt;
+    }
+    return compiler.determinize(*nfa);
+  }
+
+  bool match(std::string_view text) const {
+    size_t state = start;
+    for (unsigned char c : text) {
+      state = table[state * 256 + c];
+      if (state == dead) {
+        return false;
+      }
+    }
+    return accepting[state];
+  }
+private:
+  static constexpr size_t dead = 0;
+  static constexpr size_t max_states = 1024;
+
+  struct Node {
+    std::bitset<256> chars;
+    int next = -1;
+    std::vector<int> epsilon;
+  };
+
+  // A piece of the NFA, whose end node has no outgoing edge yet.
+  struct Fragment {
+    int start;
+    int end;
+  };
+
+  class Compiler {
+  public:
+    Compiler(std::string_view pattern) : pattern(pattern) {}
+
+    std::optional<Fragment> parse() {
+      // regex_match matches the whole string anyway.
+      if (!pattern.empty() && pattern.front() == '^') {
+        pattern.remove_prefix(1);
+      }
+      if (!pattern.empty() && pattern.back() == '$' && (pattern.size() < 2 || pattern[pattern.size() - 2] != '\\')) {
+        pattern.remove_suffix(1);
+      }
+      auto result = alternation();
+      if (!result || at < pattern.size() || nodes.size() > max_nodes) {
+        return std::nullopt;
+      }
+      return result;
+    }
+
+    std::optional<Dfa> determinize(const Fragment& nfa) {
+      Dfa dfa;
+      std::map<std::vector<int>, size_t> ids;
+      std::vector<std::vector<int>> states;
+      auto add = [&](std::vector<int> set) {
+        auto [it, inserted] = ids.emplace(set, states.size());
+        if (inserted) {
+          states.push_back(std::move(set));
+        }
+        return it->second;
+      };
+      add({});
+      dfa.start = add(closure({nfa.start}));
+      for (size_t i = 0; i < states.size(); i++) {
+        if (states.size() > max_states) {
+          return std::nullopt;
+        }
+        dfa.table.resize(states.size() * 256, dead);
+        for (int c = 0; c < 256; c++) {
+          std::vector<int> moved;
+          for (int node : states[i]) {
+            if (nodes[node].chars[c]) {
+              moved.push_back(nodes[node].next);
+            }
+          }
+          if (!moved.empty()) {
+            auto target = add(closure(std::move(moved)));
+            dfa.table[i * 256 + c] = static_cast<uint16_t>(target);
+          }
+        }
+      }
+      dfa.table.resize(states.size() * 256, dead);
+      for (const auto& state : states) {
+        dfa.accepting.push_back(std::binary_search(state.begin(), state.end(), nfa.end));
+      }
+      return dfa;
+    }
+  private:
+    static constexpr size_t max_nodes = 4096;
+
+    int node() {
+      nodes.emplace_back();
+      return static_cast<int>(nodes.size() - 1);
+    }
+
+    std::vector<int> closure(std::vector<int> set) const {
+      std::vector<bool> seen(nodes.size());
+      std::vector<int> result;
+      while (!set.empty()) {
+        int current = set.back();
+        set.pop_back();
+        if (seen[current]) {
+          continue;
+        }
+        seen[current] = true;
+        result.push_back(current);
+        for (int next : nodes[current].epsilon) {
+          set.push_back(next);
+        }
+      }
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+
+    Fragment empty() {
+      int start = node(), end = node();
+      nodes[start].epsilon.push_back(end);
+      return {start, end};
+    }
+
+    Fragment chars(const std::bitset<256>& set) {
+      int start = node(), end = node();
+      nodes[start].chars = set;
+      nodes[start].next = end;
+      return {start, end};
+    }
+
+    Fragment concat(Fragment a, Fragment b) {
+      nodes[a.end].epsilon.push_back(b.start);
+      return {a.start, b.end};
+    }
+
+    bool peek(char c) const {
+      return at < pattern.size() && pattern[at] == c;
+    }
+
+    std::optional<Fragment> alternation() {
+      auto left = sequence();
+      while (left && peek('|')) {
+        at++;
+        auto right = sequence();
+        if (!right) {
+          return std::nullopt;
+        }
+        int start = node(), end = node();
+        nodes[start].epsilon = {left->start, right->start};
+        nodes[left->end].epsilon.push_back(end);
+        nodes[right->end].epsilon.push_back(end);
+        left = Fragment {start, end};
+      }
+      return left;
+    }
+
+    std::optional<Fragment> sequence() {
+      auto result = empty();
+      while (at < pattern.size() && !peek('|') && !peek(')')) {
+        auto next = repeat();
+        if (!next || nodes.size() > max_nodes) {
+          return std::nullopt;
+        }
+        result = concat(result, *next);
+      }
+      return result;
+    }
+
+    std::optional<Fragment> repeat() {
+      size_t atom_start = at;
+      auto result = atom();
+      if (!result) {
+        return std::nullopt;
+      }
+      if (at < pattern.size()) {
+        size_t min = 0, max = 0;
+        bool unbounded = false;
+        char c = pattern[at];
+        if (c == '*') {
+          unbounded = true;
+          at++;
+        } else if (c == '+') {
+          min = 1;
+          unbounded = true;
+          at++;
+        } else if (c == '?') {
+          max = 1;
+          at++;
+        } else if (c == '{') {
+          if (!bounds(min, max, unbounded)) {
+            return std::nullopt;
+          }
+        } else {
+          return result;
+        }
+        // Lazy quantifiers match the same strings as a whole.
+        if (peek('?')) {
+          at++;
+        }
+        // Repetitions are built from copies of the atom, parsed again. A copy
+        // fails like the atom would once the automaton grows too large.
+        auto copy = [&]() -> std::optional<Fragment> {
+          auto saved = at;
+          at = atom_start;
+          auto fragment = atom();
+          at = saved;
+          if (nodes.size() > max_nodes) {
+            return std::nullopt;
+          }
+          return fragment;
+        };
+        bool first = true;
+        auto next = [&]() -> std::optional<Fragment> {
+          if (first) {
+            first = false;
+            return result;
+          }
+          return copy();
+        };
+        auto repeated = empty();
+        for (size_t i = 0; i < min; i++) {
+          auto body = next();
+          if (!body) {
+            return std::nullopt;
+          }
+          repeated = concat(repeated, *body);
+        }
+        if (unbounded) {
+          auto body = next();
+          if (!body) {
+            return std::nullopt;
+          }
+          int start = node(), end = node();
+          nodes[start].epsilon = {body->start, end};
+          nodes[body->end].epsilon.push_back(body->start);
+          nodes[body->end].epsilon.push_back(end);
+          repeated = concat(repeated, {start, end});
+        } else {
+          for (size_t i = min; i < max; i++) {
+            auto body = next();
+            if (!body) {
+              return std::nullopt;
+            }
+            int start = node(), end = node();
+            nodes[start].epsilon = {body->start, end};
+            nodes[body->end].epsilon.push_back(end);
+            repeated = concat(repeated, {start, end});
+          }
+        }
+        if (nodes.size() > max_nodes) {
+          return std::nullopt;
+        }
+        result = repeated;
+      }
+      return result;
+    }
+
+    // Parses `{n}`, `{n,}` or `{n,m}`.
+    bool bounds(size_t& min, size_t& max, bool& unbounded) {
+      auto number = [&](size_t& out) {
+        size_t start = at;
+        out = 0;
+        while (at < pattern.size() && pattern[at] >= '0' && pattern[at] <= '9' && out <= 100) {
+          out = out * 10 + (pattern[at++] - '0');
+        }
+        return at > start && out <= 100;
+      };
+      at++;
+      if (!number(min)) {
+        return false;
+      }
+      max = min;
+      if (peek(',')) {
+        at++;
+        if (peek('}')) {
+          unbounded = true;
+        } else if (!number(max) || max < min) {
+          return false;
+        }
+      }
+      if (!peek('}')) {
+        return false;
+      }
+      at++;
+      return true;
+    }
+
+    std::optional<Fragment> atom() {
+      char c = pattern[at];
+      if (c == '(') {
+        at++;
+        if (peek('?')) {
+          // Only non-capturing groups, no lookarounds.
+          if (at + 1 >= pattern.size() || pattern[at + 1] != ':') {
+            return std::nullopt;
+          }
+          at += 2;
+        }
+        auto inner = alternation();
+        if (!inner || !peek(')')) {
+          return std::nullopt;
+        }
+        at++;
+        return inner;
+      }
+      if (c == '[') {
+        std::bitset<256> set;
+        if (!char_class(set)) {
+          return std::nullopt;
+        }
+        return chars(set);
+      }
+      if (c == '.') {
+        at++;
+        std::bitset<256> set;
+        set.set();
+        set.reset('\n');
+        set.reset('\r');
+        return chars(set);
+      }
+      if (c == '\\') {
+        std::bitset<256> set;
+        if (!escape(set)) {
+          return std::nullopt;
+        }
+        return chars(set);
+      }
+      if (c == '*' || c == '+' || c == '?' || c == '{' || c == '}' || c == ']' || c == '^' || c == '$') {
+        return std::nullopt;
+      }
+      at++;
+      std::bitset<256> set;
+      set.set(static_cast<unsigned char>(c));
+      return chars(set);
+    }
+
+    // Parses an escape sequence starting at '\'.
+    bool escape(std::bitset<256>& set) {
+      at++;
+      if (at >= pattern.size()) {
+        return false;
+      }
+      char c = pattern[at++];
+      auto range = [&](char from, char to) {
+        for (int i = from; i <= to; i++) {
+          set.set(i);
+        }
+      };
+      switch (c) {
+        case 'd': case 'D':
+          range('0', '9');
+          break;
+        case 'w': case 'W':
+          range('0', '9');
+          range('a', 'z');
+          range('A', 'Z');
+          set.set('_');
+          break;
+        case 's': case 'S':
+          for (char space : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+            set.set(static_cast<unsigned char>(space));
+          }
+          break;
+        case 't': set.set('\t'); return true;
+        case 'n': set.set('\n'); return true;
+        case 'r': set.set('\r'); return true;
+        case 'f': set.set('\f'); return true;
+        case 'v': set.set('\v'); return true;
+        default:
+          // Other letters and digits are anchors, backreferences or code points.
+          if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            return false;
+          }
+          set.set(static_cast<unsigned char>(c));
+          return true;
+      }
+      if (c == 'D' || c == 'W' || c == 'S') {
+        set.flip();
+      }
+      return true;
+    }
+
+    static int first_of(const std::bitset<256>& set) {
+      int i = 0;
+      while (!set[i]) {
+        i++;
+      }
+      return i;
+    }
+
+    // Parses a `[...]` class.
+    bool char_class(std::bitset<256>& set) {
+      at++;
+      bool negate = peek('^');
+      if (negate) {
+        at++;
+      }
+      // ECMAScript reads `[]` as an empty class, rare enough to leave to std::regex.
+      if (peek(']')) {
+        return false;
+      }
+      while (at < pattern.size() && !peek(']')) {
+        int from;
+        if (peek('\\')) {
+          std::bitset<256> escaped;
+          if (!escape(escaped)) {
+            return false;
+          }
+          if (escaped.count() != 1) {
+            set |= escaped;
+            continue;
+          }
+          from = first_of(escaped);
+        } else {
+          from = static_cast<unsigned char>(pattern[at++]);
+        }
+        if (peek('-') && at + 1 < pattern.size() && pattern[at + 1] != ']') {
+          at++;
+          int to;
+          if (peek('\\')) {
+            std::bitset<256> escaped;
+            if (!escape(escaped) || escaped.count() != 1) {
+              return false;
+            }
+            to = first_of(escaped);
+          } else {
+            to = static_cast<unsigned char>(pattern[at++]);
+          }
+          if (to < from) {
+            return false;
+          }
+          for (int i = from; i <= to; i++) {
+            set.set(i);
+          }
+        } else {
+          set.set(from);
+        }
+      }
+      if (!peek(']')) {
+        return false;
+      }
+      at++;
+      if (negate) {
+        set.flip();
+      }
+      return true;
+    }
+
+    std::string_view pattern;
+    size_t at = 0;
+    std::vector<Node> nodes;
+  };
+
+  std::vector<uint16_t> table;
+  std::vector<bool> accepting;
+  size_t start = 0;
+};
+
+} // namespace regex_internal
+
+// Finds the first value outside of [min, max], comparing several values per
+// instruction when SIMD is available (see CONFY_NO_SIMD).
+inline std::optional<size_t> find_out_of_range(Span<const double> values, double min, double max) {
+  const double* data = values.data();
+  size_t count = values.size();
+  size_t i = 0;
+#if defined(CONFY_SIMD_AVX2)
+  const __m256d low = _mm256_set1_pd(min);
+  const __m256d high = _mm256_set1_pd(max);
+  for (; i + 4 <= count; i += 4) {
+    __m256d value = _mm256_loadu_pd(data + i);
+    __m256d out = _mm256_or_pd(_mm256_cmp_pd(value, low, _CMP_LT_OQ), _mm256_cmp_pd(value, high, _CMP_GT_OQ));
+    if (_mm256_movemask_pd(out)) {
+      break;
+    }
+  }
+#elif defined(CONFY_SIMD_SSE2)
+  const __m128d low = _mm_set1_pd(min);
+  const __m128d high = _mm_set1_pd(max);
+  for (; i + 2 <= count; i += 2) {
+    __m128d value = _mm_loadu_pd(data + i);
+    if (_mm_movemask_pd(_mm_or_pd(_mm_cmplt_pd(value, low), _mm_cmpgt_pd(value, high)))) {
+      break;
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    if (data[i] < min || data[i] > max) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
 template <int N1>
 class MinNumType : public NumType {
 public:
@@ -19,6 +525,13 @@ public:
     return std::nullopt;
   }
 
+  std::optional<std::pair<size_t, std::string>> validate_each(Span<const double> values) const override {
+    if (auto i = find_out_of_range(values, N1, std::numeric_limits<double>::infinity())) {
+      return std::make_pair(*i, *validate(values[*i]));
+    }
+    return std::nullopt;
+  }
+
   static std::shared_ptr<NumType> create() {
     return std::make_shared<MinNumType<N1>>();
   }
@@ -36,6 +549,13 @@ public:
     return std::nullopt;
   }
 
+  std::optional<std::pair<size_t, std::string>> validate_each(Span<const double> values) const override {
+    if (auto i = find_out_of_range(values, -std::numeric_limits<double>::infinity(), N1)) {
+      return std::make_pair(*i, *validate(values[*i]));
+    }
+    return std::nullopt;
+  }
+
   static std::shared_ptr<NumType> create() {
     return std::make_shared<MaxNumType<N1>>();
   }
@@ -54,6 +574,13 @@ public:
     return std::nullopt;
   }
 
+  std::optional<std::pair<size_t, std::string>> validate_each(Span<const double> values) const override {
+    if (auto i = find_out_of_range(values, N1, N2)) {
+      return std::make_pair(*i, *validate(values[*i]));
+    }
+    return std::nullopt;
+  }
+
   static std::shared_ptr<NumType> create() {
     return std::make_shared<RangeNumType<N1, N2>>();
   }
@@ -71,25 +598,60 @@ public:
     return std::nullopt;
   }
 
+  std::optional<std::pair<size_t, std::string>> validate_each(Span<const std::string_view> values) const override {
+    for (size_t i = 0; i < values.size(); i++) {
+      if (values[i].size() < S1) {
+        return std::make_pair(i, *validate(std::string(values[i])));
+      }
+    }
+    return std::nullopt;
+  }
+
   static std::shared_ptr<StringType> create() {
     return std::make_shared<MinStrType<S1>>();
   }
 };
 
+/**
+ * The pattern is compiled once, when the type is created: to a DFA when it
+ * fits the supported subset (see regex_internal::Dfa), to a std::regex otherwise.
+ */
 class StrRegexType : public StringType {
   std::string regex;
+  std::optional<regex_internal::Dfa> dfa;
+  std::regex compiled;
 public:
-  StrRegexType(const std::string& regex) : regex(regex) {}
+  StrRegexType(const std::string& regex)
+    : regex(regex), dfa(regex_internal::Dfa::compile(regex)), compiled(dfa ? std::regex() : std::regex(regex)) {}
+
+  std::string fingerprint() const override {
+    return StringType::fingerprint() + "/" + regex + "/";
+  }
+
+  bool matches(std::string_view value) const {
+    if (dfa) {
+      return dfa->match(value);
+    }
+    return std::regex_match(value.begin(), value.end(), compiled);
+  }
 
   std::optional<std::string> validate(const std::string& value) const override {
-    if (!std::regex_match(value, std::regex(regex))) {
+    if (!matches(value)) {
       return "String must match the regex: " + regex;
     }
     return std::nullopt;
   }
 
+  std::optional<std::pair<size_t, std::string>> validate_each(Span<const std::string_view> values) const override {
+    for (size_t i = 0; i < values.size(); i++) {
+      if (!matches(values[i])) {
+        return std::make_pair(i, "String must match the regex: " + regex);
+      }
+    }
+    return std::nullopt;
+  }
+
   static std::shared_ptr<StringType> create(const std::string& regex) {
     return std::make_shared<StrRegexType>(regex);
   }
 };
-
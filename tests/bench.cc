@@ -0,0 +1,306 @@
+#define CONFY_USE_UTILS
+#include "../src/confy.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+
+// Counts every allocation made through the global operator new. The
+// replacements are kept out of line, or GCC flags the inlined malloc/free
+// pairs as mismatched.
+static std::atomic<size_t> allocations {0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+// std::pmr's default resource allocates through the aligned overloads.
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  auto alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+  size = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+  if (void* ptr = std::aligned_alloc(alignment, size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+struct Settings {
+  size_t size = 1 << 20;    // Approximate size of the configuration, in bytes
+  size_t depth = 3;         // Levels of nested objects in each section
+  size_t array = 16;        // Elements per array
+  size_t keys = 8;          // Keys per object (besides the nested one)
+  size_t iterations = 20;   // Runs of each measurement
+  size_t lookups = 100000;  // Lookups per latency measurement
+  std::string file = "bench.confy";
+};
+
+/**
+ * Generates a configuration and its interface: top-level sections sharing the
+ * same object type, each nesting `depth` objects with `keys` keys cycling
+ * through strings, numbers, arrays of numbers and arrays of strings.
+ */
+class Generator {
+public:
+  Generator(const Settings& settings) : settings(settings) {}
+
+  std::shared_ptr<confy::Type> object_type(size_t level) {
+    std::vector<confy::ObjectType::TypePair> types;
+    for (size_t i = 0; i < settings.keys; i++) {
+      types.push_back({"k" + std::to_string(i), key_type(i)});
+    }
+    if (level + 1 < settings.depth) {
+      types.push_back({"child", object_type(level + 1)});
+    }
+    return confy::Type::Object(types);
+  }
+
+  void object(std::ostringstream& out, size_t level, const std::string& path) {
+    std::string indent(level * 2 + 2, ' ');
+    for (size_t i = 0; i < settings.keys; i++) {
+      auto key = "k" + std::to_string(i);
+      out << indent << key << " = ";
+      switch (i % 4) {
+        case 0: out << "\"value " << counter++ << "\""; break;
+        case 1: out << counter++; leaves.push_back(path + "." + key); break;
+        case 2: array(out, false); break;
+        default: array(out, true); break;
+      }
+      out << "\n";
+    }
+    if (level + 1 < settings.depth) {
+      out << indent << "child = {\n";
+      object(out, level + 1, path + ".child");
+      out << indent << "}\n";
+    }
+  }
+
+  std::string config() {
+    std::ostringstream out;
+    sections = 0;
+    while (static_cast<size_t>(out.tellp()) < settings.size) {
+      auto name = "section" + std::to_string(sections++);
+      out << name << " {\n";
+      object(out, 0, name);
+      out << "}\n";
+    }
+    return out.str();
+  }
+
+  confy::Interface interface() {
+    auto type = object_type(0);
+    std::vector<confy::Interface::Global> globals;
+    for (size_t i = 0; i < sections; i++) {
+      globals.push_back({"section" + std::to_string(i), type});
+    }
+    return confy::Interface::create(globals);
+  }
+
+  // The dotted keys of every number, for lookups.
+  std::vector<std::string> leaves;
+private:
+  std::shared_ptr<confy::Type> key_type(size_t i) {
+    switch (i % 4) {
+      case 0: return confy::Type::String;
+      case 1: return confy::RangeNumType<0, 1000000000>::create();
+      case 2: return confy::Type::Array(confy::Type::Number);
+      default: return confy::Type::Array(confy::Type::String);
+    }
+  }
+
+  void array(std::ostringstream& out, bool strings) {
+    out << "[";
+    for (size_t i = 0; i < settings.array; i++) {
+      out << (i ? ", " : "");
+      if (strings) {
+        out << "\"item" << i << "\"";
+      } else {
+        out << (counter++ % 1000) * 0.5;
+      }
+    }
+    out << "]";
+  }
+
+  const Settings& settings;
+  size_t sections = 0;
+  size_t counter = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Timing {
+  double best = 0;
+  double mean = 0;
+};
+
+template <typename F>
+Timing measure(size_t iterations, F&& run) {
+  Timing timing {1e300, 0};
+  for (size_t i = 0; i < iterations; i++) {
+    auto start = Clock::now();
+    run();
+    auto elapsed = seconds_since(start);
+    timing.best = std::min(timing.best, elapsed);
+    timing.mean += elapsed / iterations;
+  }
+  return timing;
+}
+
+static bool read_setting(const std::string& arg, const std::string& name, size_t& out) {
+  auto prefix = "--" + name + "=";
+  if (arg.rfind(prefix, 0) != 0) {
+    return false;
+  }
+  out = std::stoull(arg.substr(prefix.size()));
+  return true;
+}
+
+int main(int argc, char** argv) {
+  Settings settings;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (!read_setting(arg, "size", settings.size) && !read_setting(arg, "depth", settings.depth)
+      && !read_setting(arg, "array", settings.array) && !read_setting(arg, "keys", settings.keys)
+      && !read_setting(arg, "iterations", settings.iterations) && !read_setting(arg, "lookups", settings.lookups)) {
+      std::cerr << "usage: " << argv[0] << " [--size=N] [--depth=N] [--array=N] [--keys=N] [--iterations=N] [--lookups=N]" << std::endl;
+      return 1;
+    }
+  }
+  settings.depth = std::max<size_t>(settings.depth, 1);
+  settings.keys = std::max<size_t>(settings.keys, 2);
+
+  Generator generator(settings);
+  auto config = generator.config();
+  auto root = generator.interface();
+  double megabytes = config.size() / (1024.0 * 1024.0);
+
+  // Check the generated configuration once, and count the allocations of a parse.
+  size_t before = allocations.load();
+  auto checked = confy::parse(root, std::string_view(config));
+  size_t parse_allocations = allocations.load() - before;
+  if (checked.has_errors()) {
+    const auto& error = checked.get_errors_ref().front();
+    std::cerr << "invalid configuration: " << error.get_message() << " at "
+      << error.get_position().line << ":" << error.get_position().column << std::endl;
+    return 1;
+  }
+
+  confy::Options arena;
+  arena.use_arena = true;
+  before = allocations.load();
+  confy::parse(root, std::string_view(config), arena);
+  size_t arena_allocations = allocations.load() - before;
+
+  auto parse = measure(settings.iterations, [&] {
+    confy::parse(root, std::string_view(config));
+  });
+  auto parse_arena = measure(settings.iterations, [&] {
+    confy::parse(root, std::string_view(config), arena);
+  });
+  // Only checking the syntax, then building a single section.
+  confy::Options lazy;
+  lazy.lazy = true;
+  auto parse_lazy = measure(settings.iterations, [&] {
+    confy::parse(root, std::string_view(config), lazy).get_number_or(generator.leaves.front());
+  });
+
+  {
+    FILE* file = std::fopen(settings.file.c_str(), "wb");
+    if (!file) {
+      std::cerr << "could not write " << settings.file << std::endl;
+      return 1;
+    }
+    std::fwrite(config.data(), 1, config.size(), file);
+    std::fclose(file);
+  }
+  auto parse_file = measure(settings.iterations, [&] {
+    confy::parse_file(root, settings.file);
+  });
+  std::remove(settings.file.c_str());
+
+  // Lookups of random numbers, keyed and through compiled paths.
+  std::mt19937 rng(42);
+  std::vector<const std::string*> keys;
+  for (size_t i = 0; i < settings.lookups; i++) {
+    keys.push_back(&generator.leaves[rng() % generator.leaves.size()]);
+  }
+  std::vector<confy::Result::Path> paths;
+  for (auto key : keys) {
+    paths.push_back(checked.compile_path(*key));
+  }
+  double sum = 0;
+  auto keyed = measure(settings.iterations, [&] {
+    for (auto key : keys) {
+      sum += checked.get_number_or(*key);
+    }
+  });
+  auto compiled = measure(settings.iterations, [&] {
+    for (const auto& path : paths) {
+      sum += checked.get_number_or(path);
+    }
+  });
+
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  auto lookup_ns = [&](const Timing& timing) { return timing.mean * 1e9 / settings.lookups; };
+  std::cout << "{\n"
+    << "  \"config\": {\"bytes\": " << config.size() << ", \"depth\": " << settings.depth
+    << ", \"array\": " << settings.array << ", \"keys\": " << settings.keys
+    << ", \"iterations\": " << settings.iterations << "},\n"
+    << "  \"parse\": {\"best_mb_s\": " << megabytes / parse.best << ", \"mean_mb_s\": " << megabytes / parse.mean
+    << ", \"allocations\": " << parse_allocations << "},\n"
+    << "  \"parse_arena\": {\"best_mb_s\": " << megabytes / parse_arena.best << ", \"mean_mb_s\": " << megabytes / parse_arena.mean
+    << ", \"allocations\": " << arena_allocations << "},\n"
+    << "  \"parse_lazy\": {\"best_mb_s\": " << megabytes / parse_lazy.best << ", \"mean_mb_s\": " << megabytes / parse_lazy.mean << "},\n"
+    << "  \"parse_file\": {\"best_ms\": " << parse_file.best * 1e3 << ", \"mean_ms\": " << parse_file.mean * 1e3 << "},\n"
+    << "  \"lookup\": {\"keyed_ns\": " << lookup_ns(keyed) << ", \"compiled_ns\": " << lookup_ns(compiled)
+    << ", \"checksum\": " << sum << "},\n"
+    << "  \"peak_rss_kb\": " << usage.ru_maxrss << "\n"
+    << "}" << std::endl;
+  return 0;
+}
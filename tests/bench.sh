@@ -0,0 +1 @@
+g++ -O2 -Wall ./bench.cc -std=c++17 -o bench && ./bench "$@"
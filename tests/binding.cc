@@ -0,0 +1,152 @@
+#define CONFY_USE_UTILS
+#define CONFY_USE_BINDING
+#include "common.hpp"
+
+#include <iostream>
+#include <sstream>
+
+// Parses the same configurations into a bound struct and with the equivalent
+// interface (eagerly and lazily), and checks all give the same values and errors.
+
+struct Server {
+  std::string host;
+  double port = 0;
+  std::vector<std::string> tags;
+};
+
+struct Config {
+  std::string name;
+  double level = 0;
+  std::vector<double> weights;
+  Server server;
+  std::vector<Server> backups;
+};
+
+template <>
+struct confy::Binding<Server> {
+  static constexpr auto fields = std::make_tuple(
+    confy::field("host", &Server::host),
+    confy::field("port", &Server::port),
+    confy::field("tags", &Server::tags)
+  );
+};
+
+template <>
+struct confy::Binding<Config> {
+  static constexpr auto fields = std::make_tuple(
+    confy::field<confy::MinStrType<2>>("name", &Config::name),
+    confy::field<confy::RangeNumType<0, 3>>("level", &Config::level),
+    confy::field<confy::RangeNumType<0, 10>>("weights", &Config::weights),
+    confy::field("server", &Config::server),
+    confy::field("backups", &Config::backups)
+  );
+};
+
+static std::string describe(const Config& config) {
+  std::ostringstream out;
+  out << "name=" << config.name << " level=" << config.level << " weights=";
+  for (double weight : config.weights) {
+    out << weight << ",";
+  }
+  out << " host=" << config.server.host << " port=" << config.server.port << " tags=";
+  for (const auto& tag : config.server.tags) {
+    out << tag << ",";
+  }
+  out << " backups=";
+  for (const auto& backup : config.backups) {
+    out << backup.host << ":" << backup.port << ",";
+  }
+  return out.str();
+}
+
+static Config from_result(const confy::Result& result) {
+  Config config;
+  config.name = result.get_string_or("name");
+  config.level = result.get_number_or("level");
+  if (auto weights = result.get_array_ref("weights")) {
+    for (double weight : weights->get_numbers()) {
+      config.weights.push_back(weight);
+    }
+  }
+  config.server.host = result.get_string_or("server.host");
+  config.server.port = result.get_number_or("server.port");
+  if (auto tags = result.get_array_ref("server.tags")) {
+    for (size_t i = 0; i < tags->size(); i++) {
+      config.server.tags.emplace_back(tags->get_string_view(i));
+    }
+  }
+  if (auto backups = result.get_array_ref("backups")) {
+    for (const auto& element : backups->get_elements()) {
+      const auto& backup = static_cast<const confy::Object&>(*element);
+      Server server;
+      if (auto host = backup.find("host")) {
+        server.host = host->as_string();
+      }
+      if (auto port = backup.find("port")) {
+        server.port = port->as_number();
+      }
+      config.backups.push_back(server);
+    }
+  }
+  return config;
+}
+
+int main() {
+  auto root = confy::interface_of<Config>();
+  const char* configs[] = {
+    // Valid, with both forms of top level objects.
+    "name = \"confy\"\nlevel = 2\nweights = [0.5, 1]\nserver {\n  host = \"localhost\"\n  port = 80\n  tags = [\"a\", \"b\"]\n}\n",
+    "server = {\n  port = 8080\n}\nname = \"ab\"\n",
+    // Missing keys keep their defaults.
+    "level = 1\n",
+    "",
+    // Duplicate keys, at the top level and nested.
+    "name = \"first\"\nname = \"second\"\n",
+    "level = 1\nlevel = 2\n",
+    "server {\n  port = 1\n  port = 2\n}\n",
+    "server {\n  port = 1\n}\nserver {\n  port = 2\n}\n",
+    "name = \"ok\"\nname = 5\n",
+    // Unknown keys.
+    "bogus = 1\n",
+    "server {\n  bogus = 1\n}\n",
+    "server {\n  bogus  = 1\n}\n",
+    // Validator failures.
+    "level = 5\n",
+    "name = \"a\"\n",
+    // Type mismatches and syntax errors.
+    "name = 1\n",
+    "weights = [1, \"two\"]\n",
+    "server {\n  tags = [\"a\", 1]\n}\n",
+    "backups = [{\n  host = \"a\"\n}, {\n  port = 2\n}]\n",
+    "backups = [{\n  port = 1\n  port = 2\n}]\n",
+    "backups = [{\n  port = \"x\"\n}]\n",
+    "backups = [1]\n",
+    "server { port = 1 }\n",
+    "level = 1 name = \"ab\"\n",
+    "level =\n",
+    // Array elements are validated once the whole array is read.
+    "weights = [1, 20]\n",
+    "weights = [1, 20, \"x\"]\n",
+    "weights = [1, 20\n",
+    "weights = [1, ]\n",
+    "weights = [1,]\n",
+  };
+  int i = 0;
+  for (const char* text : configs) {
+    Config bound;
+    auto bound_errors = confy::parse_into(text, bound);
+    auto bound_out = bound_errors.empty() ? describe(bound) : describe(bound_errors);
+    std::cout << i++ << ": " << bound_out << std::endl;
+    for (bool lazy : {false, true}) {
+      confy::Options options;
+      options.lazy = lazy;
+      auto result = confy::parse(root, std::string_view(text), options);
+      result.get_root_ref();
+      auto parsed_out = result.has_errors() ? describe(result.get_errors_ref()) : describe(from_result(result));
+      if (bound_out != parsed_out) {
+        std::cout << "   mismatch, " << (lazy ? "lazy " : "") << "parse gave: " << parsed_out << std::endl;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include "common.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Parses a file through its binary cache, and checks when the cache is used
+// (the validators do not run then), rewritten, or ignored because the file,
+// the interface or the cache itself changed.
+
+static const char* file = "cache_test.confy";
+static const char* cache = "cache_test.confy.cache";
+
+static void write(const std::string& path, const std::string& contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+static std::string read(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+static void run(const char* step, confy::Interface& root, const confy::Options& options = {}) {
+  validations = 0;
+  auto result = confy::parse_file_cached(root, file, "", options);
+  std::cout << step << ": " << (validations ? "parsed" : "cached");
+  for (const auto& error : result.get_errors()) {
+    std::cout << " error: " << error.get_message();
+  }
+  std::cout << " name=" << result.get_string_or("server.name") << " ports=";
+  if (auto ports = result.get_array_ref("server.ports")) {
+    for (double port : ports->get_numbers()) {
+      std::cout << port << ",";
+    }
+  }
+  std::cout << " timeout=" << result.get_number_or("timeout") << std::endl;
+}
+
+int main() {
+  std::shared_ptr<confy::Type> port = std::make_shared<CountedNumType>(65535);
+  auto server = confy::Type::Object({
+    {"name", confy::Type::String},
+    {"ports", confy::Type::Array(port)},
+  });
+  auto root = confy::Interface::create({
+    {"server", server},
+    {"timeout", port},
+  });
+  std::remove(cache);
+
+  write(file, "server {\n  name = \"alpha\"\n  ports = [80, 443]\n}\ntimeout = 30\n");
+  run("first", root);
+  run("again", root);
+  confy::Options mapped;
+  mapped.map_file = true;
+  run("mapped", root, mapped);
+  confy::Options arena;
+  arena.use_arena = true;
+  run("arena", root, arena);
+
+  // The file changed, so the cache is stale.
+  write(file, "server {\n  name = \"beta\"\n  ports = [8080]\n}\n");
+  run("changed file", root);
+  run("again", root);
+
+  // Results with errors are not cached.
+  write(file, "server {\n  name = \"gamma\"\n  ports = [70000]\n}\n");
+  run("errors", root);
+  run("again", root);
+  write(file, "server {\n  name = \"beta\"\n  ports = [8080]\n}\n");
+  run("fixed", root);
+
+  // Corrupted caches are parsed again, then rewritten.
+  auto valid = read(cache);
+  write(cache, valid.substr(0, valid.size() / 2));
+  run("truncated cache", root);
+  run("again", root);
+  auto flipped = valid;
+  flipped[flipped.size() - 1] ^= 1;
+  write(cache, flipped);
+  run("flipped byte", root);
+  write(cache, "not a cache");
+  run("garbage", root);
+  write(cache, "");
+  run("empty", root);
+  run("again", root);
+
+  // A cache written for another interface is not used.
+  auto other = confy::Interface::create({
+    {"server", server},
+    {"timeout", port},
+    {"retries", port},
+  });
+  run("other interface", other);
+  run("again", other);
+  run("back", root);
+
+  std::remove(file);
+  std::remove(cache);
+  return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef CONFY_TESTS_COMMON_HPP
+#define CONFY_TESTS_COMMON_HPP
+
+#include "../src/confy.hpp"
+
+#include <sstream>
+
+// Helpers shared by the tests.
+
+// How many numbers went through a CountedNumType.
+inline int validations = 0;
+
+// A number type counting its validations, to tell when values get built.
+struct CountedNumType : public confy::NumType {
+  explicit CountedNumType(double max) : max(max) {}
+
+  std::optional<std::string> validate(double value) const override {
+    validations++;
+    if (value > max) {
+      return "Number must be at most " + std::to_string(static_cast<int>(max));
+    }
+    return std::nullopt;
+  }
+
+  double max;
+};
+
+// Errors on one line, with their positions.
+inline std::string describe(const std::vector<confy::Error>& errors) {
+  std::ostringstream out;
+  for (const auto& error : errors) {
+    std::string message;
+    for (char c : error.get_message()) {
+      message += c == '\n' ? "\\n" : c == '\0' ? "\\0" : std::string(1, c);
+    }
+    out << (out.tellp() ? " " : "") << "error: " << message << " at "
+      << error.get_position().line << ":" << error.get_position().column;
+  }
+  return out.str();
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include "../src/confy.hpp"
+
+#include <iostream>
+
+// Parses deeply nested values, which are read with an explicit stack, and
+// checks where Options::max_depth stops them.
+
+static std::string nested(size_t depth) {
+  return "deep = " + std::string(depth, '[') + "1" + std::string(depth, ']') + "\n";
+}
+
+static void run(const char* name, confy::Interface& root, const std::string& config, const confy::Options& options) {
+  auto result = confy::parse(root, config, options);
+  // Builds lazy results, which adds their errors.
+  result.get_root_ref();
+  std::cout << name << ": ";
+  if (result.has_errors()) {
+    for (const auto& error : result.get_errors()) {
+      std::cout << "error: " << error.get_message() << " at "
+        << error.get_position().line << ":" << error.get_position().column;
+    }
+    std::cout << std::endl;
+    return;
+  }
+  // Count the levels of the value that was built.
+  size_t depth = 0;
+  for (auto value = result.get_array_ref("deep"); value; depth++) {
+    auto inner = value->get_elements().empty() ? nullptr : value->get_elements()[0].get();
+    value = inner && inner->is_array() ? static_cast<const confy::Array*>(inner) : nullptr;
+  }
+  std::cout << "ok";
+  if (depth) {
+    std::cout << ", " << depth << " arrays";
+  }
+  std::cout << std::endl;
+}
+
+int main() {
+  // The schema has to be as deep as the values.
+  std::vector<std::shared_ptr<confy::Type>> types = {confy::Type::Number};
+  for (size_t i = 1; i <= 3000; i++) {
+    types.push_back(confy::Type::Array(types.back()));
+  }
+  auto arrays = [&](size_t depth) {
+    return confy::Interface::create({{"deep", types[depth]}});
+  };
+  auto object = confy::Type::Object({{"b", confy::Type::Object({{"c", confy::Type::Number}})}});
+  auto objects = confy::Interface::create({{"a", object}});
+
+  confy::Options defaults;
+  confy::Options raised;
+  raised.max_depth = 5000;
+  confy::Options unbounded;
+  unbounded.max_depth = 1000000;
+  confy::Options low;
+  low.max_depth = 2;
+  confy::Options lowest;
+  lowest.max_depth = 1;
+  for (bool lazy : {false, true}) {
+    std::cout << (lazy ? "lazy" : "eager") << std::endl;
+    defaults.lazy = raised.lazy = unbounded.lazy = low.lazy = lowest.lazy = lazy;
+    // The number inside the arrays is one level deeper than the innermost array.
+    auto root = arrays(1023);
+    run("1023 arrays", root, nested(1023), defaults);
+    root = arrays(1024);
+    run("1024 arrays", root, nested(1024), defaults);
+    root = arrays(3000);
+    run("3000 arrays", root, nested(3000), defaults);
+    run("3000 arrays, raised limit", root, nested(3000), raised);
+    // The value is deeper than its type, which only stops it after the
+    // syntax-only pass of lazy results has gone through all of it.
+    root = arrays(5);
+    run("100000 arrays, raised limit", root, nested(100000), raised);
+    run("100000 arrays, no limit", root, nested(100000), unbounded);
+    root = arrays(1);
+    run("1 array, limit 1", root, nested(1), lowest);
+    run("1 empty array, limit 1", root, "deep = []\n", lowest);
+    run("objects", objects, "a {\n  b = {\n    c = 1\n  }\n}\n", defaults);
+    run("objects, limit 2", objects, "a {\n  b = {\n    c = 1\n  }\n}\n", low);
+  }
+  return 0;
+}
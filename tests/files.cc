@@ -0,0 +1,72 @@
+#include "common.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// Parses batches of files with parse_files on several threads, and checks
+// the results come back in the order of the files, each with the values and
+// errors parse_file gives it.
+
+static std::string describe(const confy::Result& result) {
+  std::string out = "name=" + result.get_string_or("name") + " id="
+    + std::to_string(static_cast<int>(result.get_number_or("id", -1)));
+  return result.has_errors() ? out + " " + describe(result.get_errors()) : out;
+}
+
+int main() {
+  auto root = confy::Interface::create({
+    {"name", confy::Type::String},
+    {"id", confy::Type::Number},
+  });
+
+  // Files of different sizes, so the workers run out of work at different
+  // times and steal from each other.
+  const size_t count = 40;
+  std::vector<std::string> files;
+  for (size_t i = 0; i < count; i++) {
+    files.push_back("files_test_" + std::to_string(i) + ".confy");
+    std::ofstream out(files.back(), std::ios::binary | std::ios::trunc);
+    out << "name = \"file" << i << "\"\n";
+    for (size_t padding = i * 997 % 5000; padding > 0; padding--) {
+      out << "# padding\n";
+    }
+    out << "id = " << i << "\n";
+  }
+  {
+    std::ofstream out(files[7], std::ios::binary | std::ios::trunc);
+    out << "name = 7\nid = \"seven\"\n";
+  }
+  std::remove(files[23].c_str());
+
+  std::vector<std::string> expected;
+  for (const auto& file : files) {
+    expected.push_back(describe(confy::parse_file(root, file)));
+  }
+  std::cout << "file 0: " << expected[0] << std::endl;
+  std::cout << "file 7: " << expected[7] << std::endl;
+  std::cout << "file 23: " << expected[23] << std::endl;
+
+  confy::Options mapped;
+  mapped.map_file = true;
+  for (size_t threads : {1, 2, 3, 8, 64}) {
+    for (const auto& options : {confy::Options(), mapped}) {
+      auto results = confy::parse_files(root, files, options, threads);
+      size_t mismatches = results.size() == count ? 0 : 1;
+      for (size_t i = 0; i < results.size() && i < count; i++) {
+        if (describe(results[i]) != expected[i]) {
+          mismatches++;
+          std::cout << "   mismatch on file " << i << ": " << describe(results[i]) << std::endl;
+        }
+      }
+      std::cout << threads << " threads" << (options.map_file ? ", mapped" : "") << ": " << results.size()
+        << " results, " << mismatches << " mismatches" << std::endl;
+    }
+  }
+  std::cout << "no files: " << confy::parse_files(root, {}).size() << " results" << std::endl;
+
+  for (const auto& file : files) {
+    std::remove(file.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+#define CONFY_USE_UTILS
+#include "common.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+// Parses configurations lazily, and checks which values get built (their
+// validators only run then), when errors show up, and that they are those of
+// an eager parse once everything is built.
+
+int main() {
+  std::shared_ptr<confy::Type> counted = std::make_shared<CountedNumType>(100);
+  auto root = confy::Interface::create({
+    {"a", confy::Type::Object({
+      {"x", counted},
+      {"list", confy::Type::Array(counted)},
+    })},
+    {"b", counted},
+    {"c", confy::Type::String},
+  });
+  confy::Options lazy;
+  lazy.lazy = true;
+
+  // Values are built, and validated, by the first lookup reaching them.
+  const char* text = "a {\n  x = 1\n  list = [2, 3]\n}\nb = 4\nc = \"five\"\n";
+  validations = 0;
+  auto result = confy::parse(root, text, lazy);
+  std::cout << "parsed: " << validations << " validations" << std::endl;
+  std::cout << "b: " << result.get_number_or("b") << ", " << validations << " validations" << std::endl;
+  std::cout << "b again: " << result.get_number_or("b") << ", " << validations << " validations" << std::endl;
+  std::cout << "a.list: " << result.get_array_ref("a.list")->size() << " elements, " << validations << " validations" << std::endl;
+  std::cout << "a.x: " << result.get_number_or("a.x") << ", " << validations << " validations" << std::endl;
+  std::cout << "missing: " << result.get_number_or("missing", -1) << ", " << validations << " validations" << std::endl;
+
+  // Copies share the values built so far.
+  auto copy = result;
+  validations = 0;
+  std::cout << "copy c: " << copy.get_string_or("c") << ", " << validations << " validations" << std::endl;
+  std::cout << "same value: " << (copy.get_array_ref("a.list") == result.get_array_ref("a.list")) << std::endl;
+
+  // Concurrent lookups build each value once.
+  auto shared = confy::parse(root, text, lazy);
+  validations = 0;
+  std::vector<std::thread> threads;
+  std::vector<const confy::Array*> found(4);
+  for (size_t i = 0; i < found.size(); i++) {
+    threads.emplace_back([&, i]() {
+      found[i] = shared.get_array_ref("a.list");
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::cout << "threads: " << (found[0] == found[1] && found[1] == found[2] && found[2] == found[3]) << ", "
+    << validations << " validations" << std::endl;
+
+  // Errors can be read while other threads' lookups add to them.
+  auto invalid = confy::parse(root, "a {\n  x = 500\n}\nb = 400\nc = 5\n", lazy);
+  threads.clear();
+  for (const char* key : {"a.x", "b", "c", "a.list"}) {
+    threads.emplace_back([&, key]() {
+      invalid.get_errors();
+      invalid.get_number_or(key);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // In the order the threads built the values.
+  std::vector<std::string> described;
+  for (const auto& error : invalid.get_errors_ref()) {
+    described.push_back(describe({error}));
+  }
+  std::sort(described.begin(), described.end());
+  std::cout << "concurrent errors:";
+  for (const auto& error : described) {
+    std::cout << " " << error;
+  }
+  std::cout << std::endl;
+
+  // Syntax errors and unknown or duplicate top level keys are found up front,
+  // errors against the interface once a lookup reaches them. Without errors up
+  // front, the errors are those of an eager parse once everything is built (an
+  // eager parse can report an error against the interface before a syntax error).
+  const char* configs[] = {
+    "b = 4\nb = 5\n",
+    "a {\n  x = 1\nb = 4\n",
+    "a {\n  x = 1\n}\nb = [4\n",
+    "bogus = 1\n",
+    "a {\n  x = 500\n}\nb = 4\n",
+    "a {\n  list = [1, 200]\n}\nb = 4\n",
+    "a {\n  x = \"one\"\n}\nb = 4\n",
+    "a {\n  y = 1\n}\nb = 4\n",
+    "b = 4\nc = 5\n",
+  };
+  int i = 0;
+  for (const char* config : configs) {
+    auto parsed = confy::parse(root, config, lazy);
+    bool syntax_error = parsed.has_errors();
+    auto errors = [&]() { return parsed.has_errors() ? describe(parsed.get_errors()) : "none"; };
+    std::cout << i++ << ": up front: " << errors() << " | b: " << parsed.get_number_or("b", -1) << ", " << errors()
+      << " | all: ";
+    parsed.get_root_ref();
+    std::cout << errors() << std::endl;
+    auto eager = confy::parse(root, config);
+    if (!syntax_error && describe(eager.get_errors()) != describe(parsed.get_errors())) {
+      std::cout << "   mismatch, eager parse gave: " << describe(eager.get_errors()) << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "../src/confy.hpp"
+
+#include <iostream>
+#include <map>
+
+// Overlays results on top of each other, and checks the merged values, which
+// of them are shared with the inputs, and that they outlive the inputs.
+
+static std::string describe(const confy::Value* value) {
+  if (value->is_string()) {
+    return "\"" + std::string(value->as_string()) + "\"";
+  }
+  if (value->is_number()) {
+    return std::to_string(static_cast<int>(value->as_number()));
+  }
+  if (value->is_array()) {
+    std::string result = "[";
+    for (const auto& element : static_cast<const confy::Array*>(value)->get_elements()) {
+      result += describe(element.get()) + ",";
+    }
+    return result + "]";
+  }
+  // Entries sorted by key, so the output does not depend on the schema's order.
+  std::map<std::string, std::string> entries;
+  for (const auto& [key, entry] : *static_cast<const confy::Object*>(value)) {
+    entries.emplace(key, describe(entry.get()));
+  }
+  std::string result = "{";
+  for (const auto& [key, entry] : entries) {
+    result += key + ":" + entry + ";";
+  }
+  return result + "}";
+}
+
+static std::string describe(const confy::Result& result) {
+  std::map<std::string, std::string> entries;
+  for (const auto& [key, value] : result.get_root_ref()) {
+    entries.emplace(key, describe(value.get()));
+  }
+  std::string out;
+  for (const auto& [key, value] : entries) {
+    out += key + "=" + value + " ";
+  }
+  for (const auto& error : result.get_errors()) {
+    out += "error: " + error.get_message() + " ";
+  }
+  return out;
+}
+
+static const confy::Value* find(const confy::Result& result, const std::string& path) {
+  auto dot = path.find('.');
+  auto it = result.get_root_ref().find(path.substr(0, dot));
+  if (it == result.get_root_ref().end()) {
+    return nullptr;
+  }
+  const confy::Value* value = it->second.get();
+  if (dot != std::string::npos) {
+    value = static_cast<const confy::Object*>(value)->find(path.substr(dot + 1));
+  }
+  return value;
+}
+
+// Whether the merged result holds the very value of the input.
+static const char* shared(const confy::Result& merged, const confy::Result& input, const std::string& path) {
+  return find(merged, path) == find(input, path) ? "shared" : "new";
+}
+
+static const char* base_text = "server {\n  host = \"base\"\n  ports = [80, 443]\n  tags = [\"a\"]\n}\n"
+  "limits {\n  memory = 512\n}\nname = \"base\"\n";
+static const char* prod_text = "server {\n  host = \"prod\"\n}\nlevel = 3\n";
+static const char* host_text = "server {\n  ports = [8080]\n}\nname = \"host\"\n";
+
+int main() {
+  auto root = confy::Interface::create({
+    {"server", confy::Type::Object({
+      {"host", confy::Type::String},
+      {"ports", confy::Type::Array(confy::Type::Number)},
+      {"tags", confy::Type::Array(confy::Type::String)},
+    })},
+    {"limits", confy::Type::Object({{"memory", confy::Type::Number}})},
+    {"name", confy::Type::String},
+    {"level", confy::Type::Number},
+  });
+
+  auto base = confy::parse(root, base_text);
+  auto prod = confy::parse(root, prod_text);
+  auto merged = confy::merge(root, base, prod);
+  std::cout << "base + prod: " << describe(merged) << std::endl;
+  std::cout << "  server: " << shared(merged, base, "server") << ", server.host: " << shared(merged, prod, "server.host")
+    << ", server.ports: " << shared(merged, base, "server.ports") << ", limits: " << shared(merged, base, "limits")
+    << ", level: " << shared(merged, prod, "level") << std::endl;
+  std::cout << "  changed from base:";
+  for (const auto& key : base.diff(merged)) {
+    std::cout << " " << key;
+  }
+  std::cout << std::endl;
+
+  // Merged results can be merged again, and keep their inputs alive.
+  auto chained = [&]() {
+    confy::Options arena;
+    arena.use_arena = true;
+    confy::Options lazy;
+    lazy.lazy = true;
+    auto first = confy::merge(root, confy::parse(root, std::string(base_text), arena), confy::parse(root, std::string(prod_text)));
+    return confy::merge(root, first, confy::parse(root, std::string(host_text), lazy));
+  }();
+  std::cout << "base + prod + host: " << describe(chained) << std::endl;
+  std::cout << "  server.host: " << chained.get_string_or("server.host") << ", first port: "
+    << chained.get_array_ref("server.ports")->get_numbers()[0] << std::endl;
+
+  // Empty results on either side.
+  auto empty = confy::parse(root, "");
+  std::cout << "empty + base: " << describe(confy::merge(root, empty, base)) << std::endl;
+  std::cout << "base + empty: " << describe(confy::merge(root, base, empty)) << std::endl;
+
+  // Errors of both inputs are kept.
+  auto broken = confy::parse(root, "level = \"high\"\n");
+  std::cout << "base + broken: " << describe(confy::merge(root, base, broken)) << std::endl;
+  // Including those found while building lazy results.
+  confy::Options lazy;
+  lazy.lazy = true;
+  auto lazy_broken = confy::parse(root, "level = \"high\"\n", lazy);
+  std::cout << "base + lazy broken: " << describe(confy::merge(root, base, lazy_broken)) << std::endl;
+
+  // Results of another interface can not be merged.
+  auto other_root = confy::Interface::create({{"name", confy::Type::String}});
+  auto other = confy::parse(other_root, "name = \"other\"\n");
+  std::cout << "base + other: " << describe(confy::merge(root, base, other)) << std::endl;
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include "../src/confy.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Looks values up with dotted keys and `*` patterns, in eager and lazy
+// results, and checks what they match, including keys that miss.
+
+static std::string describe(const confy::Value* value) {
+  if (value->is_string()) {
+    return "\"" + std::string(value->as_string()) + "\"";
+  }
+  if (value->is_number()) {
+    return std::to_string(static_cast<int>(value->as_number()));
+  }
+  return value->is_array() ? "[...]" : "{...}";
+}
+
+int main() {
+  auto server = confy::Type::Object({
+    {"host", confy::Type::String},
+    {"port", confy::Type::Number},
+  });
+  auto row = confy::Type::Array(confy::Type::Number);
+  auto root = confy::Interface::create({
+    {"servers", confy::Type::Array(server)},
+    {"limits", confy::Type::Object({
+      {"memory", confy::Type::Number},
+      {"cpu", confy::Type::Number},
+    })},
+    {"ports", confy::Type::Array(confy::Type::Number)},
+    {"grid", confy::Type::Array(row)},
+    {"name", confy::Type::String},
+  });
+  const char* text = "servers = [{\n  host = \"a\"\n  port = 80\n}, {\n  host = \"b\"\n  port = 81\n}]\n"
+    "limits {\n  memory = 512\n  cpu = 2\n}\nports = [1, 2]\ngrid = [[1, 2], [3]]\nname = \"main\"\n";
+  const char* patterns[] = {
+    // Wildcards in the middle, at the end, and alone.
+    "servers.*.port",
+    "servers.*",
+    "limits.*",
+    "*",
+    "*.memory",
+    // Rows of numbers are leaves.
+    "grid.*.*",
+    // Plain keys.
+    "servers.1.host",
+    "limits.cpu",
+    "grid.1",
+    // Out of range or malformed indices.
+    "servers.2.port",
+    "servers.-1.port",
+    "servers.01x.port",
+    "servers.",
+    // Elements of arrays of numbers have no key.
+    "ports.0",
+    "ports.*",
+    // Keys under a value that is not an object or array.
+    "name.x",
+    "name.*",
+    "limits.cpu.*",
+    "missing.*",
+  };
+  confy::Options lazy;
+  lazy.lazy = true;
+  for (bool is_lazy : {false, true}) {
+    std::cout << (is_lazy ? "lazy" : "eager") << std::endl;
+    for (const char* pattern : patterns) {
+      // Lazy results are queried before anything was built.
+      auto result = confy::parse(root, text, is_lazy ? lazy : confy::Options());
+      // Sorted, as top level keys come in the schema's hash order.
+      std::vector<std::string> matches;
+      for (const auto& path : result.query(pattern)) {
+        matches.push_back(std::string(path.get_key()) + "=" + describe(path.get_value()));
+      }
+      std::sort(matches.begin(), matches.end());
+      std::cout << pattern << ":";
+      for (const auto& match : matches) {
+        std::cout << " " << match;
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  // Elements of arrays of objects are compared through their entries.
+  auto before = confy::parse(root, text);
+  auto after = confy::parse(root, "servers = [{\n  host = \"a\"\n  port = 8080\n}]\nports = [1, 3]\n");
+  auto changed = before.diff(after);
+  std::sort(changed.begin(), changed.end());
+  std::cout << "changed:";
+  for (const auto& key : changed) {
+    std::cout << " " << key;
+  }
+  std::cout << std::endl;
+
+  // Arrays of numbers are read whole, and can be copied and moved like any value.
+  auto ports = *before.get_array_ref("ports");
+  auto moved = std::move(ports);
+  confy::Array assigned = *before.get_array_ref("grid");
+  assigned = moved;
+  std::cout << "ports: " << assigned.get_numbers().size() << " numbers, " << assigned.get_elements().size()
+    << " elements, first " << describe(assigned.get_elements()[0].get()) << ", as string '"
+    << assigned.get_string_view(0) << "'" << std::endl;
+  return 0;
+}
@@ -0,0 +1,95 @@
+// Catches reads of empty optionals and out of range indices while compiling.
+#define _GLIBCXX_ASSERTIONS
+#define CONFY_USE_UTILS
+#include "../src/confy.hpp"
+
+#include <functional>
+#include <iostream>
+#include <random>
+
+// Matches strings with StrRegexType, which compiles the patterns it can to a
+// DFA, and with std::regex, and checks both agree. Patterns too large for the
+// DFA must fall back to std::regex.
+
+static int mismatches = 0;
+
+static void check(const std::string& pattern, const std::vector<std::string>& texts) {
+  confy::StrRegexType type(pattern);
+  std::regex regex(pattern);
+  for (const auto& text : texts) {
+    bool expected = std::regex_match(text, regex);
+    if (type.matches(text) != expected) {
+      mismatches++;
+      std::cout << "   mismatch: /" << pattern << "/ on '" << text << "', std::regex gave " << expected << std::endl;
+    }
+  }
+}
+
+static const char* engine(const std::string& pattern) {
+  return confy::regex_internal::Dfa::compile(pattern) ? "dfa" : "std::regex";
+}
+
+int main() {
+  struct Case {
+    std::string pattern;
+    std::vector<std::string> texts;
+  };
+  std::vector<Case> cases = {
+    {"^[0-9]+\\.[0-9]+\\.[0-9]+$", {"1.2.3", "10.0.12", "1.2", "1.2.3.4", "a.b.c", ""}},
+    {"[a-z][a-z0-9_-]*", {"host", "host-1", "Host", "1host", ""}},
+    {"(?:https?|ftp)://[^ ]+", {"http://x", "https://x.y", "ftp://a", "gopher://a", "http://"}},
+    {"\\d{2,4}", {"1", "12", "1234", "12345"}},
+    {"a{3}", {"aa", "aaa", "aaaa"}},
+    {"a{2,}b?", {"a", "aa", "aab", "aaaaab", "aabb"}},
+    {"(ab|a)*?c", {"c", "abc", "aabac", "abab"}},
+    {"\\w+\\s\\W", {"ab !", "ab a", "_ ."}},
+    {".+", {"x", "", "a\nb"}},
+    // Nested counted repetitions, the last ones over the DFA's size limit.
+    {"(a{2}){3}", {"aaaaa", "aaaaaa", "aaaaaaa"}},
+    {"(a{1,2}b){2,3}", {"abab", "aabab", "ababaab", "abababab"}},
+    {"(a{50}){50}", {std::string(2500, 'a'), std::string(2499, 'a'), ""}},
+    {"((a{10}){10}){10}", {std::string(1000, 'a'), std::string(999, 'a')}},
+    {"((a{20}){20}){20}", {"a", ""}},
+    {"(a|b{100}){100}c", {"c", "ac", "aaac", "b"}},
+    // Outside of the DFA's subset.
+    {"(a)\\1", {"aa", "ab"}},
+    {"a(?=b)b", {"ab", "a"}},
+  };
+  for (const auto& test : cases) {
+    std::cout << "/" << test.pattern << "/: " << engine(test.pattern) << std::endl;
+    check(test.pattern, test.texts);
+  }
+
+  // Random patterns over a small alphabet, matched against every short string.
+  std::mt19937 random(1);
+  auto pick = [&](std::vector<std::string> choices) {
+    return choices[random() % choices.size()];
+  };
+  std::function<std::string(int)> pattern = [&](int depth) {
+    std::string result;
+    for (size_t length = 1 + random() % (depth == 0 ? 3 : 2); length > 0; length--) {
+      result += depth == 0 && random() % 4 == 0 ? "(" + pattern(depth + 1) + ")" : pick({"a", "b", ".", "[ab]", "[^a]", "\\d"});
+      // Nested unbounded repetitions would make std::regex backtrack for ages.
+      result += depth == 0 ? pick({"", "", "*", "+", "?", "{2}", "{1,3}", "{2,}"}) : pick({"", "", "?", "{2}", "{1,3}"});
+    }
+    if (random() % 4 == 0) {
+      result += "|" + pattern(depth + 1);
+    }
+    return result;
+  };
+  std::vector<std::string> texts = {""};
+  for (size_t i = 0; texts[i].size() < 4; i++) {
+    for (char c : {'a', 'b', '1'}) {
+      texts.push_back(texts[i] + c);
+    }
+  }
+  int count = 200, compiled = 0;
+  for (int i = 0; i < count; i++) {
+    auto random_pattern = pattern(0);
+    compiled += confy::regex_internal::Dfa::compile(random_pattern).has_value();
+    check(random_pattern, texts);
+  }
+  std::cout << "random patterns: " << count << ", " << compiled << " to a dfa" << std::endl;
+  std::cout << "mismatches: " << mismatches << std::endl;
+  return 0;
+}
@@ -0,0 +1,109 @@
+#define CONFY_USE_RELOAD
+#include "common.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Watches a file with a Reloader while it is rewritten, and checks the
+// snapshots and changed keys passed to the subscribers, that invalid files
+// keep the last snapshot, and that destroying the reloader stops its thread.
+
+static const char* file = "reload_test.confy";
+
+static void write(const std::string& contents) {
+  // Written aside then renamed, as editors often do, so the watcher never
+  // sees half a file.
+  std::string temporary = std::string(file) + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out << contents;
+  }
+  std::filesystem::rename(temporary, file);
+}
+
+static size_t threads() {
+  auto tasks = std::filesystem::directory_iterator("/proc/self/task");
+  return std::distance(std::filesystem::begin(tasks), std::filesystem::end(tasks));
+}
+
+static std::string describe(const confy::Result& snapshot) {
+  std::string out = "name=" + snapshot.get_string_or("server.name") + " port="
+    + std::to_string(static_cast<int>(snapshot.get_number_or("server.port")));
+  return snapshot.has_errors() ? out + " " + describe(snapshot.get_errors()) : out;
+}
+
+int main() {
+  auto root = confy::Interface::create({
+    {"server", confy::Type::Object({
+      {"name", confy::Type::String},
+      {"port", confy::Type::Number},
+    })},
+    {"level", confy::Type::Number},
+  });
+  write("server {\n  name = \"alpha\"\n  port = 80\n}\nlevel = 1\n");
+  auto before = threads();
+
+  {
+    confy::Reloader reloader(root, file);
+    std::cout << "first: " << describe(*reloader.get()) << std::endl;
+    std::cout << "threads: +" << threads() - before << std::endl;
+
+    std::mutex mutex;
+    std::condition_variable called;
+    std::vector<std::string> changes;
+    size_t calls = 0;
+    reloader.subscribe([&](const confy::Result& snapshot, const std::vector<std::string>& changed) {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto keys = changed;
+      std::sort(keys.begin(), keys.end());
+      std::string out = describe(snapshot) + ", changed:";
+      for (const auto& key : keys) {
+        out += " " + key;
+      }
+      changes.push_back(out);
+      calls++;
+      called.notify_all();
+    });
+    auto wait = [&](size_t count) {
+      std::unique_lock<std::mutex> lock(mutex);
+      called.wait_for(lock, std::chrono::seconds(10), [&] { return calls >= count; });
+    };
+
+    // The watcher reparses the rewritten file and publishes it.
+    write("server {\n  name = \"beta\"\n  port = 80\n}\nlevel = 2\n");
+    wait(1);
+    std::cout << "rewritten: " << (changes.empty() ? "no callback" : changes.back()) << std::endl;
+    std::cout << "snapshot: " << describe(*reloader.get()) << std::endl;
+
+    // Readers keep the snapshot they hold.
+    confy::Reloader::Reader reader(reloader);
+    auto held = reader.snapshot();
+    std::cout << "held: " << describe(*held) << std::endl;
+
+    // An invalid file is reported, but does not replace the snapshot.
+    write("server {\n  name = 5\n}\n");
+    auto version = reloader.get_version();
+    for (int i = 0; i < 1000 && reloader.get_errors().empty(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cout << "invalid: " << describe(reloader.get_errors()) << std::endl;
+    std::cout << "kept: " << describe(*reloader.get()) << ", same version: " << (reloader.get_version() == version)
+      << ", callbacks: " << calls << std::endl;
+
+    // Fixing it publishes again and clears the errors.
+    write("server {\n  name = \"gamma\"\n  port = 81\n}\nlevel = 2\n");
+    wait(2);
+    std::cout << "fixed: " << (changes.size() < 2 ? "no callback" : changes.back()) << std::endl;
+    std::cout << "errors: " << reloader.get_errors().size() << ", reader: " << describe(reader.get())
+      << ", held: " << describe(*held) << std::endl;
+  }
+
+  // The destructor joined the watching thread.
+  std::cout << "destroyed, threads: +" << threads() - before << std::endl;
+  std::remove(file);
+  return 0;
+}
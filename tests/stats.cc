@@ -0,0 +1,134 @@
+#define CONFY_USE_STATS
+#define CONFY_USE_UTILS
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Parses with instrumentation enabled, and checks the statistics of eager,
+// arena and lazy results, the order the hooks are called in, and that the
+// allocations counted are those the value tree made.
+
+static size_t news = 0;
+
+void* operator new(size_t size) {
+  news++;
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+// Used by std::pmr::new_delete_resource.
+void* operator new(size_t size, std::align_val_t alignment) {
+  news++;
+  auto align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+  if (void* ptr = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+struct Tracer : confy::Hooks {
+  void on_value_begin(const confy::Type& type, const confy::Error::Position& pos) override {
+    out << "<" << type.name() << "@" << pos.line << ":" << pos.column << " ";
+  }
+  void on_value_end(const confy::Type& type, bool ok) override {
+    out << type.name() << (ok ? ">" : "!>") << " ";
+  }
+  void on_validate_begin(const confy::Type& type) override {
+    out << "validate " << type.name() << " ";
+  }
+  void on_validate_end(const confy::Type& /* type */, bool valid) override {
+    out << (valid ? "valid " : "invalid ");
+  }
+
+  std::ostringstream out;
+};
+
+static std::string describe(const confy::Stats& stats) {
+  std::ostringstream out;
+  out << "bytes=" << stats.bytes << " strings=" << stats.strings << " numbers=" << stats.numbers
+    << " objects=" << stats.objects << " arrays=" << stats.arrays << " depth=" << stats.max_depth
+    << " validations=" << stats.validations;
+  return out.str();
+}
+
+int main() {
+  std::shared_ptr<confy::Type> counted = std::make_shared<CountedNumType>(100);
+  auto root = confy::Interface::create({
+    {"name", confy::Type::String},
+    {"level", counted},
+    {"server", confy::Type::Object({
+      {"host", confy::Type::String},
+      {"ports", confy::Type::Array(counted)},
+    })},
+    {"tags", confy::Type::Array(confy::Type::String)},
+  });
+  const std::string text = "name = \"main\"\nlevel = 2\nserver {\n  host = \"a\"\n  ports = [80, 81, 82]\n}\n"
+    "tags = [\"x\", \"y\"]\n";
+
+  confy::Options arena;
+  arena.use_arena = true;
+  confy::Options lazy;
+  lazy.lazy = true;
+  for (auto [name, options] : {std::make_pair("eager", confy::Options()), std::make_pair("arena", arena)}) {
+    auto result = confy::parse(root, text, options);
+    const auto& stats = result.stats();
+    std::cout << name << ": " << describe(stats) << ", allocated: " << (stats.allocations > 0) << ", timed: "
+      << (stats.parse_time.count() > 0 && stats.validate_time.count() > 0) << std::endl;
+
+    // Contiguous arrays create their elements when first read, which is counted too.
+    auto ports = result.get_array_ref("server.ports");
+    auto allocations = stats.allocations;
+    auto before = news;
+    auto elements = ports->get_elements();
+    std::cout << "  elements: " << elements.size() << ", allocations: +" << stats.allocations - allocations;
+    // Without an arena, each of them is an allocation from the global heap.
+    if (!options.use_arena) {
+      std::cout << ", from the heap: +" << news - before;
+    }
+    std::cout << std::endl;
+    ports->get_elements();
+    std::cout << "  read again: +" << stats.allocations - allocations << std::endl;
+  }
+
+  // Lazy results count values as they get built.
+  auto result = confy::parse(root, text, lazy);
+  std::cout << "lazy: " << describe(result.stats()) << std::endl;
+  result.get_number_or("level");
+  std::cout << "  level: " << describe(result.stats()) << std::endl;
+  result.get_root_ref();
+  std::cout << "  all: " << describe(result.stats()) << std::endl;
+
+  // Hooks are called around every value and validator call, failed ones included.
+  Tracer tracer;
+  confy::Options traced;
+  traced.hooks = &tracer;
+  auto failed = confy::parse(root, "level = 2\nserver {\n  ports = [80, 800]\n}\nname = 3\n", traced);
+  std::cout << "hooks: " << tracer.out.str() << std::endl;
+  std::cout << "  " << describe(failed.stats()) << " " << describe(failed.get_errors()) << std::endl;
+
+  // Results that were not parsed have no statistics.
+  auto created = confy::Result::create({}, "");
+  std::cout << "created: " << describe(created.stats()) << ", allocations=" << created.stats().allocations << std::endl;
+  return 0;
+}
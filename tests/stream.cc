@@ -0,0 +1,113 @@
+#define CONFY_USE_UTILS
+#include "common.hpp"
+
+#include <iostream>
+#include <sstream>
+
+// Feeds configurations to a StreamParser whole and cut into chunks of every
+// size, and checks the events do not depend on the cuts and the errors are
+// those of confy::parse.
+
+struct Recorder : confy::Handler {
+  bool on_key(std::string_view key, const confy::Type& type) override {
+    out << key << ":" << type.name() << " ";
+    return key != "skipped";
+  }
+  void on_enter_object() override { out << "{ "; }
+  void on_exit_object() override { out << "} "; }
+  void on_begin_array() override { out << "[ "; }
+  void on_end_array() override { out << "] "; }
+  void on_string(std::string_view value) override { out << '"' << value << "\" "; }
+  void on_number(double value) override { out << value << " "; }
+  void on_error(const confy::Error& error) override { out << "error "; (void)error; }
+
+  std::ostringstream out;
+};
+
+static std::string stream(confy::Interface& root, std::string_view text, size_t chunk) {
+  Recorder recorder;
+  confy::StreamParser parser(root, recorder);
+  for (size_t i = 0; i < text.size(); i += chunk) {
+    if (!parser.feed(text.substr(i, chunk))) {
+      break;
+    }
+  }
+  if (!parser.has_errors()) {
+    parser.finish();
+  }
+  return recorder.out.str() + describe(parser.get_errors());
+}
+
+int main() {
+  // Type::Array takes its element type by reference.
+  auto server = confy::Type::Object({
+    {"host", confy::Type::String},
+    {"port", confy::Type::Number},
+  });
+  auto row = confy::Type::Array(confy::Type::Number);
+  auto root = confy::Interface::create({
+    {"project", confy::Type::Object({
+      {"name", confy::Type::String},
+      {"tags", confy::Type::Array(confy::Type::String)},
+      {"log_level", confy::RangeNumType<0, 3>::create()},
+      {"servers", confy::Type::Array(server)},
+      {"matrix", confy::Type::Array(row)},
+      {"skipped", confy::Type::Object({{"inner", confy::Type::Number}})},
+    })},
+    {"hello", confy::Type::String},
+  });
+  const char* configs[] = {
+    // Valid.
+    "hello = \"world\"\n",
+    "# comment\nhello = \"world\" # trailing\n\nproject {\n  name = \"confy\"\n  tags = [\"a\", \"b c\"]\n"
+      "  log_level = 2\n  servers = [{\n    host = \"x\"\n    port = 80\n  }, {\n    port = 8080\n  }]\n"
+      "  matrix = [[1, 2.5], [], [300]]\n  skipped = {\n    inner = 1\n  }\n}\n",
+    "project = {\n  name = \"line\\nbreak\"\n}\n",
+    "hello = \"no newline at the end\"",
+    "project {\n}\n",
+    "project {\n\n  # comment\n  name = \"a\"\n\n}\n",
+    "project {\n  tags = [\"a\",]\n}\n",
+    // Errors.
+    "bogus = 1\n",
+    "project {\n  bogus = 1\n}\n",
+    "hello = \"a\"\nhello = \"b\"\n",
+    "project {\n  name = \"a\"\n  name = \"b\"\n}\n",
+    "project {\n  log_level = 5\n}\n",
+    "hello = 1\n",
+    "project {\n  tags = [\"a\", 1]\n}\n",
+    "project {\n  servers = [1]\n}\n",
+    "project { name = \"a\" }\n",
+    "hello = \"a\" project\n",
+    "hello =\n",
+    "hello = \"unterminated\n",
+    "project {\n  name = \"a\"\n",
+    "project {\n  name = \"a\"",
+    "project { # comment\n}\n",
+    "project {\n  tags = [\"a\", ]\n}\n",
+    "project {\n  log_level = [1]\n}\n",
+    "hello \"a\n",
+    "\"hello\" = \"a\"\n",
+  };
+  int i = 0;
+  for (const char* config : configs) {
+    std::string_view text(config);
+    auto whole = stream(root, text, text.size() + 1);
+    std::cout << i++ << ": " << whole << std::endl;
+    for (size_t chunk = 1; chunk <= text.size(); chunk++) {
+      auto cut = stream(root, text, chunk);
+      if (cut != whole) {
+        std::cout << "   mismatch in chunks of " << chunk << ": " << cut << std::endl;
+        break;
+      }
+    }
+    auto result = confy::parse(root, text);
+    Recorder recorder;
+    confy::StreamParser parser(root, recorder);
+    parser.feed(text);
+    parser.finish();
+    if (describe(parser.get_errors()) != describe(result.get_errors_ref())) {
+      std::cout << "   mismatch, parse gave: " << describe(result.get_errors_ref()) << std::endl;
+    }
+  }
+  return 0;
+}
@@ -1,2 +1,10 @@
-
+set -e
 g++ -Wall ./main.cc -std=c++17 && ./a.out
+
+# Each test prints what it checked, which must match expected/<test>.txt.
+for test in binding stream regex cache depth merge lazy query reload files stats; do
+  g++ -Wall ./$test.cc -std=c++17 && ./a.out > a.txt
+  diff -u expected/$test.txt a.txt
+  echo "$test: ok"
+done
+rm -f a.out a.txt